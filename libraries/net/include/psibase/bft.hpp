@@ -131,16 +131,28 @@ namespace psibase::net
       {
          AccountNumber prevAccount{};
          check(commits.size() >= prods.threshold(), "Not enough commits");
+         std::vector<Claim>             claims;
+         std::vector<std::vector<char>> msgs;
+         claims.reserve(commits.size());
+         msgs.reserve(commits.size());
          for (const auto& [prod, sig] : commits)
          {
             // mostly to guarantee that the producers are unique
             check(prevAccount < prod, "Commits must be ordered by producer");
+            prevAccount = prod;
             auto claim = prods.getClaim(prod);
             check(!!claim, "Not a valid producer");
-            CommitMessage originalCommit{id, prod, *claim};
-            auto          msg = network().serialize_unsigned_message(originalCommit);
-            chain().verify(revision, {msg.data(), msg.size()}, *claim, sig);
-         }
+            claims.push_back(std::move(*claim));
+            CommitMessage originalCommit{id, prod, claims.back()};
+            msgs.push_back(network().serialize_unsigned_message(originalCommit));
+         }
+         // The same BlockConfirm is carried by every block until the next
+         // commit. The verify cache in ForkDb skips the signatures that
+         // were already checked against this revision.
+         std::vector<ForkDb::SignatureCheck> checks;
+         for (std::size_t i = 0; i < commits.size(); ++i)
+            checks.push_back({msgs[i], claims[i], commits[i].signature});
+         chain().verify(revision, checks);
       }
 
       void verifyIrreversibleSignature(const auto&             revision,
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <psibase/ForkDb.hpp>
+#include <psibase/crypto.hpp>
 #include <psibase/net_base.hpp>
 #include <psio/reflect.hpp>
 
@@ -8,7 +9,12 @@
 #include <cassert>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
 #include <memory>
+#include <numeric>
+#include <optional>
 #include <variant>
 #include <vector>
 
@@ -32,13 +38,19 @@ namespace psibase::net
    {
       static constexpr unsigned type = 32;
       ExtendedBlockId           xid;
-      std::string               to_string() const
+      // Set if the sender accepts CompactBlockMessage
+      std::optional<bool> compactBlocks;
+      // The sender's commit index. This is set if the sender downloads
+      // irreversible blocks with GetBlocksRequest, in which case the
+      // receiver only pushes the blocks that follow it.
+      std::optional<BlockNum> commitNum;
+      std::string             to_string() const
       {
          return "hello: id=" + loggers::to_string(xid.id()) +
                 " blocknum=" + std::to_string(xid.num());
       }
    };
-   PSIO_REFLECT(HelloRequest, xid)
+   PSIO_REFLECT(HelloRequest, xid, compactBlocks, commitNum)
 
    struct HelloResponse
    {
@@ -64,6 +76,97 @@ namespace psibase::net
    };
    PSIO_REFLECT(BlockMessage, block)
 
+   // Identifies a transaction within a CompactBlockMessage. This is a
+   // prefix of the merkle leaf, so it covers the signatures and the
+   // subjective data as well as the transaction.
+   inline std::uint64_t short_transaction_id(const SignedTransaction& trx)
+   {
+      auto          hash = Merkle::hash_leaf(TransactionInfo{trx});
+      std::uint64_t result;
+      std::memcpy(&result, hash.data(), sizeof(result));
+      return result;
+   }
+
+   // A block with its transactions replaced by short ids. A receiver that
+   // already has the block from another peer drops it. Otherwise it asks
+   // for the transactions with GetBlockTransactions. Nodes don't relay
+   // transactions, so the receiver never has them in advance. This only
+   // avoids sending the whole block to peers that already have it.
+   struct CompactBlockMessage
+   {
+      static constexpr unsigned        type             = 42;
+      static constexpr std::size_t     max_transactions = 65536;
+      BlockHeader                      header;
+      std::vector<std::uint64_t>       transactions;
+      std::vector<char>                signature;
+      std::optional<std::vector<char>> auxConsensusData;
+      std::string                      to_string() const
+      {
+         BlockInfo info{header};
+         return "compact block: term=" + std::to_string(header.term) +
+                " leader=" + header.producer.str() + " id=" + loggers::to_string(info.blockId) +
+                " blocknum=" + std::to_string(header.blockNum) +
+                " transactions=" + std::to_string(transactions.size());
+      }
+   };
+   PSIO_REFLECT(CompactBlockMessage, header, transactions, signature, auxConsensusData)
+
+   struct GetBlockTransactions
+   {
+      static constexpr unsigned  type = 43;
+      Checksum256                blockId;
+      std::vector<std::uint32_t> indexes;
+      std::string                to_string() const
+      {
+         return "get block transactions: id=" + loggers::to_string(blockId) +
+                " count=" + std::to_string(indexes.size());
+      }
+   };
+   PSIO_REFLECT(GetBlockTransactions, blockId, indexes)
+
+   // The transactions in the order that they were requested. The list
+   // is empty if the block is no longer available.
+   struct BlockTransactions
+   {
+      static constexpr unsigned      type = 44;
+      Checksum256                    blockId;
+      std::vector<SignedTransaction> transactions;
+      std::string                    to_string() const
+      {
+         return "block transactions: id=" + loggers::to_string(blockId) +
+                " count=" + std::to_string(transactions.size());
+      }
+   };
+   PSIO_REFLECT(BlockTransactions, blockId, transactions)
+
+   // Requests a range of irreversible blocks by number
+   struct GetBlocksRequest
+   {
+      static constexpr unsigned      type      = 45;
+      static constexpr std::uint32_t max_count = 256;
+      BlockNum                       first;
+      std::uint32_t                  count;
+      std::string                    to_string() const
+      {
+         return "get blocks: first=" + std::to_string(first) + " count=" + std::to_string(count);
+      }
+   };
+   PSIO_REFLECT(GetBlocksRequest, first, count)
+
+   // The blocks starting at first. This is shorter than the request if
+   // the sender doesn't have all the blocks.
+   struct GetBlocksResponse
+   {
+      static constexpr unsigned                       type = 46;
+      BlockNum                                        first;
+      std::vector<psio::shared_view_ptr<SignedBlock>> blocks;
+      std::string                                     to_string() const
+      {
+         return "blocks: first=" + std::to_string(first) + " count=" + std::to_string(blocks.size());
+      }
+   };
+   PSIO_REFLECT(GetBlocksResponse, first, blocks)
+
    // This class manages production and distribution of blocks
    // The consensus algorithm is provided by the derived class
    template <typename Derived, typename Timer>
@@ -84,7 +187,7 @@ namespace psibase::net
       };
 
       template <typename ExecutionContext>
-      explicit blocknet(ExecutionContext& ctx) : _block_timer(ctx)
+      explicit blocknet(ExecutionContext& ctx) : _block_timer(ctx), _pending_timer(ctx)
       {
          logger.add_attribute("Channel",
                               boost::log::attributes::constant(std::string("consensus")));
@@ -100,6 +203,20 @@ namespace psibase::net
          peer_id         id;
          bool            ready  = false;
          bool            closed = false;
+         // True if the peer accepts CompactBlockMessage
+         bool compact_blocks = false;
+         // The peer's commit index, if it answers GetBlocksRequest
+         BlockNum commit_num = 0;
+         // The range of blocks that has been requested from the peer
+         bool     blocks_requested = false;
+         BlockNum requested_first  = 0;
+         BlockNum requested_last   = 0;
+         // The peer pushes the blocks after this one while we request the
+         // earlier ones, so they may arrive before their parents.
+         BlockNum push_after = 0;
+         // The number of orphans held for blocks received from the peer
+         std::size_t requested_orphans = 0;
+         std::size_t pushed_orphans    = 0;
          // True once we have received a HelloResponse from the peer
          bool peer_ready = false;
          // TODO: we may be able to save some space, because last_received is
@@ -125,9 +242,81 @@ namespace psibase::net
 
       std::vector<std::unique_ptr<peer_connection>> _peers;
 
+      // A compact block that is waiting for transactions
+      struct pending_block
+      {
+         Checksum256                            id;
+         SignedBlock                            block;
+         std::vector<std::uint32_t>             missing;
+         bool                                   requested = false;
+         typename Timer::clock_type::time_point requested_at;
+      };
+
+      // Blocks received from each peer must be inserted in the order that
+      // they were sent, because a block whose parent is unknown is dropped.
+      std::map<peer_id, std::deque<pending_block>> _pending_blocks;
+      std::size_t                                  _max_pending_blocks = 16;
+      // After this long, another peer that sent the same block asks for its
+      // transactions instead of waiting for the first request.
+      std::chrono::milliseconds _pending_timeout = std::chrono::seconds(1);
+      Timer                     _pending_timer;
+
+      // Compact blocks are usually sent to several peers in a row
+      Checksum256         _compact_block_id;
+      CompactBlockMessage _compact_block;
+
+      bool _compact_blocks = false;
+
+      // During initial sync, irreversible blocks are requested from all
+      // peers that have them, in batches of _sync_batch blocks.
+      bool                                       _range_sync = false;
+      std::uint32_t                              _sync_batch = 32;
+      BlockNum                                   _sync_next  = 0;
+      std::vector<std::pair<BlockNum, BlockNum>> _sync_retry;
+
+      // Blocks that arrived before their parent, indexed by the parent id.
+      // Only blocks that were requested are held, and each peer can only
+      // fill part of the space.
+      struct orphan_block
+      {
+         peer_id                            origin;
+         bool                               update_received;
+         psio::shared_view_ptr<SignedBlock> block;
+      };
+      std::multimap<Checksum256, orphan_block> _orphans;
+      std::size_t                              _max_orphans      = 1024;
+      std::size_t                              _max_peer_orphans = 128;
+
       loggers::common_logger logger;
 
-      using message_type = std::variant<HelloRequest, HelloResponse, BlockMessage>;
+      using message_type = std::variant<HelloRequest,
+                                        HelloResponse,
+                                        BlockMessage,
+                                        CompactBlockMessage,
+                                        GetBlockTransactions,
+                                        BlockTransactions,
+                                        GetBlocksRequest,
+                                        GetBlocksResponse>;
+
+      // Peers that are caught up receive new blocks as CompactBlockMessage.
+      // This only affects connections that are opened afterwards.
+      void set_compact_blocks(bool enable) { _compact_blocks = enable; }
+      // Peers download irreversible blocks from several peers at once
+      // instead of having each peer push them. This only affects
+      // connections that are opened afterwards.
+      void set_range_sync(bool enable) { _range_sync = enable; }
+
+      peer_connection* find_connection(peer_id id)
+      {
+         for (const auto& peer : _peers)
+         {
+            if (peer->id == id)
+            {
+               return peer.get();
+            }
+         }
+         return nullptr;
+      }
 
       peer_connection& get_connection(peer_id id)
       {
@@ -146,6 +335,18 @@ namespace psibase::net
          auto pos =
              std::find_if(_peers.begin(), _peers.end(), [&](const auto& p) { return p->id == id; });
          assert(pos != _peers.end());
+         if (_pending_blocks.erase(id))
+         {
+            // Blocks that were waiting for this peer can be requested elsewhere
+            process_pending_blocks();
+         }
+         if ((*pos)->blocks_requested)
+         {
+            (*pos)->blocks_requested = false;
+            (*pos)->commit_num       = 0;
+            _sync_retry.push_back({(*pos)->requested_first, (*pos)->requested_last});
+            request_blocks();
+         }
          if ((*pos)->syncing || !(*pos)->peer_ready)
          {
             (*pos)->closed = true;
@@ -160,8 +361,13 @@ namespace psibase::net
       {
          _peers.push_back(std::make_unique<peer_connection>(id));
          peer_connection& connection = get_connection(id);
-         connection.hello_sent       = false;
-         connection.hello.xid        = chain().get_head_state()->xid();
+         connection.hello_sent          = false;
+         connection.hello.xid           = chain().get_head_state()->xid();
+         connection.hello.compactBlocks = _compact_blocks;
+         if (_range_sync)
+         {
+            connection.hello.commitNum = chain().commit_index();
+         }
          async_send_hello(connection);
       }
       void async_send_hello(peer_connection& connection)
@@ -176,8 +382,8 @@ namespace psibase::net
             auto prev = chain().get(Checksum256(b->block().header().previous()));
             if (prev)
             {
-               connection.hello = {Checksum256(b->block().header().previous()),
-                                   BlockNum(b->block().header().blockNum()) - 1};
+               connection.hello.xid = {Checksum256(b->block().header().previous()),
+                                       BlockNum(b->block().header().blockNum()) - 1};
             }
             else
             {
@@ -215,6 +421,12 @@ namespace psibase::net
          {
             return;
          }
+         connection.compact_blocks = request.compactBlocks.value_or(false);
+         if (_range_sync)
+         {
+            connection.commit_num = request.commitNum.value_or(0);
+            connection.push_after = connection.commit_num;
+         }
          if (!connection.peer_ready &&
              connection.hello.xid.num() > request.xid.num() + connection.hello_sent)
          {
@@ -249,6 +461,14 @@ namespace psibase::net
             }
             connection.last_sent = chain().get_common_ancestor(connection.last_received);
          }
+         if (request.commitNum && connection.hello.commitNum &&
+             *connection.hello.commitNum > connection.last_sent.num())
+         {
+            // The peer requests the blocks up to the commit index that we
+            // advertised, possibly from several peers at once.
+            auto num             = *connection.hello.commitNum;
+            connection.last_sent = {chain().get_block_id(num), num};
+         }
          // async_send_fork will reset syncing if there is nothing to sync
          connection.syncing = true;
          connection.ready   = true;
@@ -258,6 +478,7 @@ namespace psibase::net
          network().async_send_block(connection.id, HelloResponse{},
                                     [this, &connection](const std::error_code&)
                                     { async_send_fork(connection); });
+         request_blocks();
       }
       void recv(peer_id origin, const HelloResponse&)
       {
@@ -445,6 +666,7 @@ namespace psibase::net
          // current block and try to hand off leadership before
          // shutting down.
          stop_leader();
+         _pending_timer.cancel();
          _state = producer_state::shutdown;
       }
 
@@ -468,10 +690,21 @@ namespace psibase::net
             assert(next_block_id != Checksum256());
             peer.last_sent  = {next_block_id, peer.last_sent.num() + 1};
             auto next_block = chain().get(next_block_id);
+            auto on_sent    = [this, &peer](const std::error_code& e) { async_send_fork(peer); };
 
-            network().async_send_block(peer.id, BlockMessage{next_block},
-                                       [this, &peer](const std::error_code& e)
-                                       { async_send_fork(peer); });
+            // Only a new head block is likely to reach the peer from
+            // several directions. A peer that is still syncing would pay a
+            // round trip for every block, so it gets the whole block.
+            if (peer.compact_blocks && peer.last_sent.num() == chain().get_head()->blockNum &&
+                next_block->block().transactions().size() != 0)
+            {
+               network().async_send_block(peer.id, make_compact_block(next_block_id, next_block),
+                                          on_sent);
+            }
+            else
+            {
+               network().async_send_block(peer.id, BlockMessage{next_block}, on_sent);
+            }
             consensus().post_send_block(peer.id, peer.last_sent.id());
          }
          else
@@ -521,6 +754,8 @@ namespace psibase::net
             }
             // ------------------------------------------------------------------
          }
+         prune_orphans();
+         request_blocks();
       }
 
       void update_last_received(auto& peer, const ExtendedBlockId& xid)
@@ -532,9 +767,30 @@ namespace psibase::net
          }
       }
 
-      void recv(peer_id origin, const BlockMessage& request)
+      const CompactBlockMessage& make_compact_block(const Checksum256&                        id,
+                                                    const psio::shared_view_ptr<SignedBlock>& block)
+      {
+         if (_compact_block_id != id)
+         {
+            _compact_block.header = block->block().header().unpack();
+            _compact_block.transactions.clear();
+            for (auto trx : block->block().transactions())
+            {
+               _compact_block.transactions.push_back(short_transaction_id(trx.unpack()));
+            }
+            _compact_block.signature        = block->signature().unpack();
+            _compact_block.auxConsensusData = block->auxConsensusData().unpack();
+            _compact_block_id               = id;
+         }
+         return _compact_block;
+      }
+
+      const BlockHeaderState* insert_one(peer_id                                   origin,
+                                         const psio::shared_view_ptr<SignedBlock>& block,
+                                         bool                                      update_received)
       {
-         if (auto state = chain().insert(request.block))
+         auto state = chain().insert(block);
+         if (state)
          {
             try
             {
@@ -547,9 +803,411 @@ namespace psibase::net
             }
             // TODO: update_last_received should run even if the block
             // is already known.
-            auto& connection = get_connection(origin);
-            update_last_received(connection, state->xid());
-            switch_fork();
+            if (auto* connection = find_connection(origin); connection && update_received)
+            {
+               update_last_received(*connection, state->xid());
+            }
+         }
+         return state;
+      }
+
+      // Holds a block whose parent is unknown. Blocks are only held if
+      // they are in a range that we requested from the peer.
+      // \return false if the block was dropped
+      bool hold_orphan(peer_id                                   origin,
+                       const psio::shared_view_ptr<SignedBlock>& block,
+                       bool                                      requested)
+      {
+         auto     header     = block->block().header();
+         BlockNum num        = header.blockNum();
+         BlockNum head       = chain().get_head()->blockNum;
+         auto*    connection = find_connection(origin);
+         if (!connection || num > head + _max_orphans)
+            return false;
+         if (requested)
+         {
+            if (connection->requested_orphans >= _max_peer_orphans)
+               return false;
+         }
+         else
+         {
+            if (connection->push_after == 0 || num <= connection->push_after)
+               return false;
+            // The blocks that the peer pushes tell us how far it can serve
+            // irreversible blocks. The older pushed blocks can be requested
+            // again after they become irreversible, but the newest cannot.
+            connection->commit_num =
+                std::max(connection->commit_num, BlockNum(header.commitNum()));
+            if (head >= connection->commit_num)
+               return false;
+            if (connection->pushed_orphans >= _max_peer_orphans)
+               drop_oldest_pushed_orphan(origin);
+         }
+         if (_orphans.size() >= _max_orphans)
+            return false;
+         _orphans.insert({Checksum256(header.previous()), {origin, !requested, block}});
+         ++(requested ? connection->requested_orphans : connection->pushed_orphans);
+         return true;
+      }
+
+      void release_orphan(const orphan_block& orphan)
+      {
+         if (auto* connection = find_connection(orphan.origin))
+            --(orphan.update_received ? connection->pushed_orphans
+                                      : connection->requested_orphans);
+      }
+
+      void drop_oldest_pushed_orphan(peer_id origin)
+      {
+         auto blockNum = [](const auto& item)
+         { return BlockNum(item.second.block->block().header().blockNum()); };
+         auto oldest   = _orphans.end();
+         for (auto pos = _orphans.begin(); pos != _orphans.end(); ++pos)
+         {
+            if (pos->second.origin == origin && pos->second.update_received &&
+                (oldest == _orphans.end() || blockNum(*pos) < blockNum(*oldest)))
+               oldest = pos;
+         }
+         if (oldest != _orphans.end())
+         {
+            release_orphan(oldest->second);
+            _orphans.erase(oldest);
+         }
+      }
+
+      // Inserts a block and any orphans that were waiting for it.
+      // \return false if the block was dropped
+      bool insert_block(peer_id                                   origin,
+                        const psio::shared_view_ptr<SignedBlock>& block,
+                        bool                                      requested = false)
+      {
+         bool update_received = !requested;
+         auto header          = block->block().header();
+         if (!chain().get_state(Checksum256(header.previous())))
+         {
+            if (BlockNum(header.blockNum()) <= chain().commit_index())
+               return true;
+            if (!hold_orphan(origin, block, requested))
+            {
+               PSIBASE_LOG(logger, debug) << "Block dropped because its parent is missing";
+               return false;
+            }
+            return true;
+         }
+         auto state = insert_one(origin, block, update_received);
+         if (!state)
+            return true;
+         std::vector<Checksum256> parents{state->blockId()};
+         while (!parents.empty())
+         {
+            auto id = parents.back();
+            parents.pop_back();
+            std::vector<orphan_block> children;
+            for (auto [pos, end] = _orphans.equal_range(id); pos != end;)
+            {
+               release_orphan(pos->second);
+               children.push_back(std::move(pos->second));
+               pos = _orphans.erase(pos);
+            }
+            for (const auto& child : children)
+            {
+               try
+               {
+                  if (auto s = insert_one(child.origin, child.block, child.update_received))
+                     parents.push_back(s->blockId());
+               }
+               catch (std::exception& e)
+               {
+                  PSIBASE_LOG(logger, warning) << "Dropped block: " << e.what();
+               }
+            }
+         }
+         switch_fork();
+         return true;
+      }
+
+      void prune_orphans()
+      {
+         auto commitIndex = chain().commit_index();
+         std::erase_if(_orphans,
+                       [&](const auto& item)
+                       {
+                          if (BlockNum(item.second.block->block().header().blockNum()) >
+                              commitIndex)
+                             return false;
+                          release_orphan(item.second);
+                          return true;
+                       });
+      }
+
+      // Assigns the next batch of blocks to every peer that can serve it
+      // and doesn't already have a request outstanding.
+      void request_blocks()
+      {
+         BlockNum head   = chain().get_head()->blockNum;
+         BlockNum window = head + _max_orphans;
+         // Blocks after the commit index may be on a different fork
+         _sync_next = std::max(_sync_next, chain().commit_index() + 1);
+         std::erase_if(_sync_retry, [&](const auto& range) { return range.second <= head; });
+         for (auto& peer : _peers)
+         {
+            // A peer whose blocks would be dropped as orphans gets no more
+            // requests until the earlier blocks arrive.
+            if (peer->closed || peer->blocks_requested || peer->commit_num == 0 ||
+                peer->requested_orphans + _sync_batch > _max_peer_orphans)
+               continue;
+            BlockNum first, last;
+            auto     retry = std::find_if(_sync_retry.begin(), _sync_retry.end(),
+                                          [&](const auto& range)
+                                          { return range.second <= peer->commit_num; });
+            if (retry != _sync_retry.end())
+            {
+               std::tie(first, last) = *retry;
+               _sync_retry.erase(retry);
+            }
+            else if (_sync_next <= peer->commit_num && _sync_next <= window)
+            {
+               first      = _sync_next;
+               last       = std::min<BlockNum>({first + _sync_batch - 1, peer->commit_num, window});
+               _sync_next = last + 1;
+            }
+            else
+            {
+               continue;
+            }
+            peer->blocks_requested = true;
+            peer->requested_first  = first;
+            peer->requested_last   = last;
+            network().async_send_block(peer->id, GetBlocksRequest{first, last - first + 1},
+                                       [](const std::error_code&) {});
+         }
+      }
+
+      void recv(peer_id origin, const GetBlocksRequest& request)
+      {
+         check(request.count <= GetBlocksRequest::max_count, "Too many blocks requested");
+         GetBlocksResponse response{request.first};
+         for (BlockNum num = request.first; num - request.first < request.count; ++num)
+         {
+            auto id = chain().get_block_id(num);
+            if (num > chain().commit_index() || id == Checksum256{})
+               break;
+            response.blocks.push_back(chain().get(id));
+         }
+         network().async_send_block(origin, response, [](const std::error_code&) {});
+      }
+
+      void recv(peer_id origin, const GetBlocksResponse& response)
+      {
+         auto& connection = get_connection(origin);
+         check(connection.blocks_requested && response.first == connection.requested_first,
+               "Unexpected blocks");
+         auto     last = connection.requested_last;
+         BlockNum num  = response.first;
+         for (const auto& block : response.blocks)
+         {
+            check(BlockNum(block->block().header().blockNum()) == num, "Wrong block number");
+            if (num > last || !insert_block(origin, block, true))
+               break;
+            ++num;
+         }
+         connection.blocks_requested = false;
+         if (num <= last)
+         {
+            if (response.blocks.size() < last - response.first + 1)
+            {
+               // The peer doesn't have the rest
+               connection.commit_num = num - 1;
+            }
+            _sync_retry.push_back({num, last});
+         }
+         request_blocks();
+      }
+
+      void recv(peer_id origin, const BlockMessage& request)
+      {
+         insert_block(origin, request.block);
+         if (!_pending_blocks.empty())
+         {
+            process_pending_blocks();
+         }
+      }
+
+      void recv(peer_id origin, const CompactBlockMessage& request)
+      {
+         check(request.transactions.size() <= CompactBlockMessage::max_transactions,
+               "Too many transactions in compact block");
+         BlockInfo info{request.header};
+         auto&     queue = _pending_blocks[origin];
+         if (queue.empty() && chain().get(info.blockId))
+         {
+            _pending_blocks.erase(origin);
+            return;
+         }
+         check(queue.size() < _max_pending_blocks, "Too many compact blocks pending");
+         pending_block pending{
+             .id    = info.blockId,
+             .block = {.block            = {.header = request.header},
+                       .signature        = request.signature,
+                       .auxConsensusData = request.auxConsensusData},
+         };
+         pending.block.block.transactions.resize(request.transactions.size());
+         pending.missing.resize(request.transactions.size());
+         std::iota(pending.missing.begin(), pending.missing.end(), std::uint32_t{0});
+         queue.push_back(std::move(pending));
+         process_pending_blocks(origin);
+      }
+
+      void recv(peer_id origin, const GetBlockTransactions& request)
+      {
+         BlockTransactions response{request.blockId};
+         if (auto block = chain().get(request.blockId))
+         {
+            auto trxs = block->block().transactions();
+            for (auto idx : request.indexes)
+            {
+               check(idx < trxs.size(), "Transaction index out of range");
+               response.transactions.push_back(trxs[idx].unpack());
+            }
+         }
+         network().async_send_block(origin, response, [](const std::error_code&) {});
+      }
+
+      void recv(peer_id origin, const BlockTransactions& response)
+      {
+         auto queue = _pending_blocks.find(origin);
+         check(queue != _pending_blocks.end(), "Unexpected block transactions");
+         auto pos = std::find_if(queue->second.begin(), queue->second.end(),
+                                 [&](const pending_block& p)
+                                 { return p.requested && p.id == response.blockId; });
+         check(pos != queue->second.end(), "Unexpected block transactions");
+         if (response.transactions.empty() && !pos->missing.empty())
+         {
+            // The peer no longer has the block. Any blocks that follow it
+            // would be dropped, so discard them as well.
+            PSIBASE_LOG(logger, debug) << "Compact block no longer available";
+            queue->second.erase(pos, queue->second.end());
+         }
+         else
+         {
+            check(response.transactions.size() == pos->missing.size(),
+                  "Wrong number of block transactions");
+            auto& trxs = pos->block.block.transactions;
+            for (std::size_t i = 0; i < pos->missing.size(); ++i)
+            {
+               trxs[pos->missing[i]] = response.transactions[i];
+            }
+            pos->missing.clear();
+         }
+         process_pending_blocks(origin);
+      }
+
+      // \return true if a request for the block's transactions is outstanding
+      // and has not timed out
+      bool is_block_requested(const Checksum256& id)
+      {
+         auto expired = Timer::clock_type::now() - _pending_timeout;
+         for (const auto& [peer, queue] : _pending_blocks)
+         {
+            for (const auto& pending : queue)
+            {
+               if (pending.requested && !pending.missing.empty() && pending.id == id &&
+                   pending.requested_at > expired)
+                  return true;
+            }
+         }
+         return false;
+      }
+
+      void request_block_transactions(peer_id origin, pending_block& pending)
+      {
+         pending.requested    = true;
+         pending.requested_at = Timer::clock_type::now();
+         network().async_send_block(origin, GetBlockTransactions{pending.id, pending.missing},
+                                    [](const std::error_code&) {});
+         // Lets the other peers that sent the block ask for it if this
+         // request times out
+         _pending_timer.expires_after(_pending_timeout);
+         _pending_timer.async_wait(
+             [this](const std::error_code& ec)
+             {
+                if (!ec && !_pending_blocks.empty())
+                   process_pending_blocks();
+             });
+      }
+
+      // Inserts the blocks at the front of the queue that are complete.
+      // \return true if any blocks were removed from the queue
+      bool process_pending_blocks(peer_id origin, std::deque<pending_block>& queue)
+      {
+         bool progress = false;
+         while (!queue.empty())
+         {
+            auto& front = queue.front();
+            if (chain().get(front.id))
+            {
+               // Already received from another peer
+               queue.pop_front();
+               progress = true;
+               continue;
+            }
+            if (!front.missing.empty())
+            {
+               if (!front.requested && !is_block_requested(front.id))
+                  request_block_transactions(origin, front);
+               break;
+            }
+            Merkle m;
+            for (const auto& trx : front.block.block.transactions)
+            {
+               m.push(TransactionInfo{trx});
+            }
+            check(m.root() == front.block.block.header.trxMerkleRoot,
+                  "Block transactions do not match the merkle root");
+            psio::shared_view_ptr<SignedBlock> block{front.block};
+            queue.pop_front();
+            progress = true;
+            insert_block(origin, block);
+         }
+         return progress;
+      }
+
+      // Processes the queue for the origin first. Errors in blocks from
+      // the origin are reported to the caller. Inserting a block may
+      // complete blocks that are waiting in the queues for other peers.
+      void process_pending_blocks(std::optional<peer_id> origin = std::nullopt)
+      {
+         bool progress = true;
+         if (origin)
+         {
+            if (auto pos = _pending_blocks.find(*origin); pos != _pending_blocks.end())
+            {
+               progress = process_pending_blocks(*origin, pos->second);
+               if (pos->second.empty())
+                  _pending_blocks.erase(pos);
+            }
+         }
+         while (progress)
+         {
+            progress = false;
+            for (auto pos = _pending_blocks.begin(); pos != _pending_blocks.end();)
+            {
+               try
+               {
+                  progress |= process_pending_blocks(pos->first, pos->second);
+               }
+               catch (std::exception& e)
+               {
+                  // The blocks that follow would be dropped as orphans
+                  PSIBASE_LOG(logger, warning) << "Dropped compact blocks: " << e.what();
+                  pos->second.clear();
+                  progress = true;
+               }
+               if (pos->second.empty())
+                  pos = _pending_blocks.erase(pos);
+               else
+                  ++pos;
+            }
          }
       }
 
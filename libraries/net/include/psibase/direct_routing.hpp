@@ -72,6 +72,7 @@ namespace psibase::net
       {
          std::sort(dest.begin(), dest.end());
          dest.erase(std::unique(dest.begin(), dest.end()), dest.end());
+         // Every peer shares the same buffer
          auto serialized_message = this->serialize_message(msg);
          for (auto peer : dest)
          {
@@ -2,6 +2,7 @@
 
 #include <psibase/SignedMessage.hpp>
 #include <psibase/block.hpp>
+#include <psibase/shared_message.hpp>
 
 #include <psio/fracpack.hpp>
 #include <psio/stream.hpp>
@@ -16,16 +17,22 @@ namespace psibase::net
    template <typename Derived>
    struct message_serializer
    {
+      // Serializes msg after offset bytes of uninitialized space
       template <typename Msg>
-      static std::vector<char> serialize_unsigned_message(const Msg& msg)
+      static std::vector<char> serialize_unsigned_message(const Msg& msg, std::size_t offset = 0)
       {
          static_assert(Msg::type < 128);
-         std::vector<char> result(psio::fracpack_size(msg) + 1);
-         result[0] = Msg::type;
-         psio::fast_buf_stream s(result.data() + 1, result.size() - 1);
+         std::vector<char> result(offset + psio::fracpack_size(msg) + 1);
+         result[offset] = Msg::type;
+         psio::fast_buf_stream s(result.data() + offset + 1, result.size() - offset - 1);
          psio::to_frac(msg, s);
          return result;
       }
+      template <typename Msg>
+      static shared_message serialize_shared_message(const Msg& msg)
+      {
+         return shared_message{serialize_unsigned_message(msg, shared_message::header_size)};
+      }
       template <NeedsSignature Msg>
       SignedMessage<Msg> sign_message(const Msg& msg)
       {
@@ -35,15 +42,16 @@ namespace psibase::net
          return {msg, sig};
       }
       template <typename Msg>
-      std::vector<char> serialize_signed_message(const Msg& msg)
+      shared_message serialize_signed_message(const Msg& msg)
       {
          // TODO: avoid serializing the message twice
-         return serialize_unsigned_message(sign_message(msg));
+         return serialize_shared_message(sign_message(msg));
       }
+      // The result can be sent to any number of peers
       template <typename Msg>
       auto serialize_message(const Msg& msg)
       {
-         return serialize_unsigned_message(msg);
+         return serialize_shared_message(msg);
       }
       template <NeedsSignature Msg>
       auto serialize_message(const Msg& msg)
@@ -9,6 +9,8 @@
 #include <deque>
 #include <functional>
 #include <iostream>
+#include <map>
+#include <type_traits>
 #include <vector>
 
 namespace psibase::net
@@ -21,9 +23,13 @@ namespace psibase::net
    {
       struct peer_info
       {
-         mock_routing*              ptr;
-         peer_id                    rid;
-         test::mock_clock::duration latency;
+         mock_routing*                ptr;
+         peer_id                      rid;
+         test::mock_clock::duration   latency;
+         // When the link will have written all the queued messages
+         test::mock_clock::time_point busy_until = {};
+         // The number of messages of each type sent on the link
+         std::map<unsigned, std::size_t> messages_sent;
       };
       explicit mock_routing(boost::asio::io_context& ctx) : ctx(ctx)
       {
@@ -56,18 +62,32 @@ namespace psibase::net
             return message;
          }
       }
-      void send(const peer_info& peer, const auto& message)
+      // \return the time until the message has been written to the link
+      test::mock_clock::duration send(peer_info& peer, const auto& message)
       {
-         if (peer.latency == test::mock_clock::duration())
+         // The type byte followed by the message
+         std::uint64_t size = psio::fracpack_size(message) + 1;
+         bytes_sent += size;
+         ++peer.messages_sent[std::remove_cvref_t<decltype(message)>::type];
+         test::mock_clock::duration written{};
+         if (bandwidth != 0)
+         {
+            auto now        = test::mock_clock::now();
+            peer.busy_until = std::max(peer.busy_until, now) +
+                              std::chrono::microseconds{size * 1000000 / bandwidth};
+            written         = peer.busy_until - now;
+         }
+         if (written + peer.latency == test::mock_clock::duration())
          {
             peer.ptr->post_recv(peer.rid, message);
          }
          else
          {
-            defer.post_after(ctx, peer.latency,
+            defer.post_after(ctx, written + peer.latency,
                              [ptr = peer.ptr, origin = peer.rid, message](const std::error_code&)
                              { ptr->post_recv(origin, message); });
          }
+         return written;
       }
       template <typename Msg, typename F>
       void async_send_block(peer_id id, const Msg& msg, F&& f)
@@ -77,8 +97,15 @@ namespace psibase::net
          {
             throw std::runtime_error("unknown peer");
          }
-         send(peer->second, msg);
-         ctx.post([f]() { f(std::error_code()); });
+         auto written = send(peer->second, msg);
+         if (written == test::mock_clock::duration())
+         {
+            ctx.post([f]() { f(std::error_code()); });
+         }
+         else
+         {
+            defer.post_after(ctx, written, [f](const std::error_code&) { f(std::error_code()); });
+         }
       }
       template <typename Msg>
       void multicast_producers(const Msg& msg)
@@ -88,7 +115,7 @@ namespace psibase::net
       template <typename Msg>
       void multicast(const Msg& msg)
       {
-         for (const auto& [id, peer] : _peers)
+         for (auto& [id, peer] : _peers)
          {
             send(peer, msg);
          }
@@ -96,7 +123,7 @@ namespace psibase::net
       template <typename Msg>
       void sendto(producer_id producer, const Msg& msg)
       {
-         for (const auto& [id, peer] : _peers)
+         for (auto& [id, peer] : _peers)
          {
             if (static_cast<Derived*>(peer.ptr)->producer_name() == producer)
             {
@@ -148,7 +175,11 @@ namespace psibase::net
       test::mock_execution_context defer;
       peer_id                      next_peer_id = 0;
       std::map<peer_id, peer_info> _peers;
-      loggers::common_logger       logger;
+      // The number of bytes that would have been written to the wire
+      std::size_t            bytes_sent = 0;
+      // Bytes per second on each outgoing link. Zero means unlimited.
+      std::uint64_t          bandwidth  = 0;
+      loggers::common_logger logger;
    };
 
 }  // namespace psibase::net
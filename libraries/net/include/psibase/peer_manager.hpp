@@ -1,6 +1,7 @@
 #pragma once
 
 #include <psibase/log.hpp>
+#include <psibase/shared_message.hpp>
 
 #include <boost/asio/dispatch.hpp>
 #include <boost/asio/io_context.hpp>
@@ -37,10 +38,10 @@ namespace psibase::net
       }
       using read_handler  = std::function<void(const std::error_code&, std::vector<char>&&)>;
       using write_handler = std::function<void(const std::error_code&)>;
-      virtual void async_write(std::vector<char>&&, write_handler) = 0;
-      virtual void async_read(read_handler)                        = 0;
-      virtual bool is_open() const                                 = 0;
-      virtual void close(close_code)                               = 0;
+      virtual void async_write(shared_message, write_handler) = 0;
+      virtual void async_read(read_handler)                   = 0;
+      virtual bool is_open() const                            = 0;
+      virtual void close(close_code)                          = 0;
       // Information for display
       virtual std::string endpoint() const { return ""; }
       //
@@ -262,7 +263,7 @@ namespace psibase::net
          async_recv(id, std::move(conn));
       }
       template <typename F>
-      void async_send(peer_id id, const std::vector<char>& msg, F&& f)
+      void async_send(peer_id id, const shared_message& msg, F&& f)
       {
          auto iter = _connections.find(id);
          if (iter == _connections.end())
@@ -270,7 +271,7 @@ namespace psibase::net
             throw std::runtime_error("unknown peer");
          }
          iter->second->async_write(
-             std::vector<char>(msg),
+             msg,
              [this, &ctx = _ctx, f = std::forward<F>(f)](const std::error_code& ec) mutable
              { boost::asio::dispatch(ctx, [this, f = std::move(f), ec]() mutable { f(ec); }); });
       }
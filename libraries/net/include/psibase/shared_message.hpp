@@ -0,0 +1,58 @@
+#pragma once
+
+#include <boost/asio/buffer.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace psibase::net
+{
+   // An immutable serialized message. Copies share the same buffer, so a
+   // message can be queued on any number of connections without copying
+   // the payload.
+   //
+   // The buffer starts with a 4-byte length prefix which is filled in on
+   // construction. Stream transports send it along with the payload.
+   // Message-based transports send only the payload.
+   class shared_message
+   {
+     public:
+      static constexpr std::size_t header_size = sizeof(std::uint32_t);
+
+      shared_message() = default;
+      // The first header_size bytes of data are reserved for the header
+      explicit shared_message(std::vector<char>&& data)
+      {
+         std::uint32_t size = data.size() - header_size;
+         std::memcpy(data.data(), &size, sizeof(size));
+         _data = std::make_shared<const std::vector<char>>(std::move(data));
+      }
+
+      std::size_t           size() const { return _data ? _data->size() - header_size : 0; }
+      std::span<const char> data() const
+      {
+         if (!_data)
+            return {};
+         return {_data->data() + header_size, size()};
+      }
+      // The payload without the header
+      boost::asio::const_buffer buffer() const
+      {
+         auto d = data();
+         return {d.data(), d.size()};
+      }
+      // The header followed by the payload
+      boost::asio::const_buffer framed_buffer() const
+      {
+         if (!_data)
+            return {};
+         return {_data->data(), _data->size()};
+      }
+
+     private:
+      std::shared_ptr<const std::vector<char>> _data;
+   };
+}  // namespace psibase::net
@@ -9,6 +9,7 @@
 #include <iostream>
 #include <memory>
 #include <psibase/net_base.hpp>
+#include <psibase/shared_message.hpp>
 #include <psio/fracpack.hpp>
 #include <queue>
 #include <vector>
@@ -49,10 +50,8 @@ namespace psibase::net
              [this, f = std::forward<F>(f)](const std::error_code& ec, std::size_t sz) mutable
              { f(ec, std::move(_read_buf)); });
       }
-      void async_write(std::vector<char>&& data, write_handler f)
+      void async_write(shared_message data, write_handler f)
       {
-         std::uint32_t size = data.size();
-         data.insert(data.begin(), (char*)&size, (char*)&size + sizeof(size));
          _write_buf.emplace_back(std::move(data), 0, std::move(f));
          if (_write_buf.size() == 1)
          {
@@ -66,9 +65,8 @@ namespace psibase::net
             _write_buf_sequence.clear();
             for (const auto& message : _write_buf)
             {
-               _write_buf_sequence.push_back(
-                   boost::asio::buffer(message._data.data() + message._bytes_written,
-                                       message._data.size() - message._bytes_written));
+               _write_buf_sequence.push_back(message._data.framed_buffer() +
+                                             message._bytes_written);
             }
             _socket.async_write_some(
                 _write_buf_sequence,
@@ -82,7 +80,8 @@ namespace psibase::net
                          _write_buf.clear();
                          break;
                       }
-                      auto available = _write_buf[i]._data.size() - _write_buf[i]._bytes_written;
+                      auto available =
+                          _write_buf[i]._data.framed_buffer().size() - _write_buf[i]._bytes_written;
                       if (available > remaining)
                       {
                          _write_buf[i]._bytes_written += remaining;
@@ -109,7 +108,7 @@ namespace psibase::net
       }
       struct serialized_message
       {
-         std::vector<char>                           _data;
+         shared_message                              _data;
          std::size_t                                 _bytes_written = 0;
          std::function<void(const std::error_code&)> _callback;
       };
@@ -80,7 +80,7 @@ namespace psibase::net
             }
          }
       }
-      void async_write(std::vector<char>&& data, write_handler f) override
+      void async_write(shared_message data, write_handler f) override
       {
          boost::asio::dispatch(
              stream.get_executor(),
@@ -97,7 +97,7 @@ namespace psibase::net
       void async_write_loop(std::shared_ptr<websocket_connection> self)
       {
          stream.binary(true);
-         stream.async_write(boost::asio::buffer(outbox.front().data),
+         stream.async_write(outbox.front().data.buffer(),
                             [self = std::move(self)](const std::error_code& ec, std::size_t sz)
                             {
                                if (!ec)
@@ -165,7 +165,7 @@ namespace psibase::net
       }
       struct message
       {
-         std::vector<char>                           data;
+         shared_message                              data;
          std::function<void(const std::error_code&)> callback;
       };
       boost::beast::websocket::stream<Stream> stream;
@@ -266,6 +266,13 @@ struct NetworkBase
 
    void recv(const psibase::net::HelloRequest&) {}
    void recv(const psibase::net::HelloResponse&) {}
+   // The fuzzer never advertises compact blocks
+   void recv(const psibase::net::CompactBlockMessage&) {}
+   void recv(const psibase::net::GetBlockTransactions&) {}
+   void recv(const psibase::net::BlockTransactions&) {}
+   // The fuzzer never advertises a commit index
+   void recv(const psibase::net::GetBlocksRequest&) {}
+   void recv(const psibase::net::GetBlocksResponse&) {}
 
    template <typename T>
    static bool has_message(const psibase::net::SignedMessage<T>&              message,
@@ -521,6 +521,29 @@ TEST_CASE("invalid committed block", "[bft]")
    CHECK_THROWS_AS(node.send(makeCommit(invalid, "d")), consensus_failure);
 }
 
+// A producer that is listed twice counts only once toward the threshold
+TEST_CASE("duplicate producer in block confirm", "[bft]")
+{
+   TEST_START(logger);
+   SingleNode<node_type> node({"a", "b", "c", "d"});
+
+   auto root   = node.head();
+   auto block1 = makeBlock(root, "b", 4);
+   node.send(block1);
+
+   BlockNum committed = BlockInfo{block1.block->block()}.header.blockNum;
+   auto     forged =
+       makeBlock(block1, "c", 5, BlockConfirm{committed, makeProducerConfirms({"b", "c", "c"})});
+   CHECK_THROWS(node.send(forged));
+   CHECK(node.head().blockId != BlockInfo{forged.block->block()}.blockId);
+
+   auto block2 =
+       makeBlock(block1, "c", 5, BlockConfirm{committed, makeProducerConfirms({"b", "c", "d"})});
+   node.send(block2);
+   CHECK(node.head().blockId == BlockInfo{block2.block->block()}.blockId);
+   CHECK(node.head().header.commitNum == committed);
+}
+
 TEST_CASE("double commit 1", "[bft]")
 {
    TEST_START(logger);
@@ -0,0 +1,92 @@
+#include <psibase/cft.hpp>
+
+#include <psibase/log.hpp>
+#include <psibase/mock_routing.hpp>
+#include <psibase/mock_timer.hpp>
+#include <psibase/node.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <catch2/catch.hpp>
+
+#include "test_util.hpp"
+
+using namespace psibase::net;
+using namespace psibase;
+using namespace psibase::test;
+using namespace std::literals::chrono_literals;
+
+using node_type = node<null_link, mock_routing, cft_consensus, ForkDb>;
+
+namespace
+{
+   struct RelayStats
+   {
+      std::size_t          bytes;
+      mock_clock::duration latency;
+   };
+
+   // Boots a fully connected network and measures how long it takes for
+   // the boot block, which carries all the system service code, to reach
+   // every node and how many bytes are sent while doing it.
+   RelayStats relayBootBlock(bool compact, mock_clock::duration linkLatency)
+   {
+      boost::asio::io_context ctx;
+      NodeSet<node_type>      nodes(ctx);
+      auto                    prods = makeAccounts({"a", "b", "c", "d"});
+      nodes.add(prods);
+      for (auto& node : nodes.nodes)
+         node->node.set_compact_blocks(compact);
+      nodes.connect_all(linkLatency);
+      boot<CftConsensus>(nodes[0].chain().getBlockContext(), prods);
+
+      auto startNum = nodes[0].chain().get_head()->blockNum;
+      auto end      = mock_clock::now() + 10s;
+      while (nodes[0].chain().get_head()->blockNum == startNum && mock_clock::now() < end)
+      {
+         mock_clock::advance();
+         ctx.poll();
+      }
+      auto bootNum  = startNum + 1;
+      auto bootId   = nodes[0].chain().get_block_id(bootNum);
+      auto produced = mock_clock::now();
+
+      auto received = [&]
+      {
+         for (const auto& node : nodes.nodes)
+         {
+            if (node->chain().get_head()->blockNum < bootNum ||
+                node->chain().get_block_id(bootNum) != bootId)
+               return false;
+         }
+         return true;
+      };
+      while (!received() && mock_clock::now() < end)
+      {
+         mock_clock::advance();
+         ctx.poll();
+      }
+      RelayStats result{0, mock_clock::now() - produced};
+      // Let duplicate copies from other peers arrive
+      runFor(ctx, 5 * linkLatency);
+      for (const auto& node : nodes.nodes)
+         result.bytes += node->node.network().bytes_sent;
+      CHECK(received());
+      return result;
+   }
+}  // namespace
+
+TEST_CASE("compact block relay", "[cft]")
+{
+   TEST_START(logger);
+
+   auto full    = relayBootBlock(false, 10ms);
+   auto compact = relayBootBlock(true, 10ms);
+   PSIBASE_LOG(logger, info) << "full blocks: " << full.bytes << " bytes, "
+                             << full.latency / 1ms << " ms";
+   PSIBASE_LOG(logger, info) << "compact blocks: " << compact.bytes << " bytes, "
+                             << compact.latency / 1ms << " ms";
+   CHECK(compact.bytes < full.bytes);
+   // The first copy costs one extra round trip to fetch the transactions
+   CHECK(compact.latency <= full.latency + 2 * 10ms + 1ms);
+}
@@ -0,0 +1,42 @@
+#include <psibase/shared_message.hpp>
+
+#include <cstring>
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+using psibase::net::shared_message;
+
+TEST_CASE("shared message framing")
+{
+   std::vector<char> data(shared_message::header_size);
+   data.insert(data.end(), {'a', 'b', 'c'});
+   shared_message msg{std::move(data)};
+   CHECK(msg.size() == 3);
+   CHECK(std::string_view{msg.data().data(), msg.data().size()} == "abc");
+   CHECK(msg.buffer().size() == 3);
+
+   auto          framed = msg.framed_buffer();
+   std::uint32_t size;
+   REQUIRE(framed.size() == shared_message::header_size + 3);
+   std::memcpy(&size, framed.data(), sizeof(size));
+   CHECK(size == 3);
+   CHECK(static_cast<const char*>(framed.data()) + shared_message::header_size ==
+         msg.buffer().data());
+}
+
+TEST_CASE("shared message copies share the buffer")
+{
+   shared_message msg{std::vector<char>(shared_message::header_size + 16)};
+   shared_message copy = msg;
+   CHECK(copy.buffer().data() == msg.buffer().data());
+   CHECK(copy.size() == 16);
+}
+
+TEST_CASE("empty shared message")
+{
+   shared_message msg;
+   CHECK(msg.size() == 0);
+   CHECK(msg.buffer().size() == 0);
+   CHECK(msg.framed_buffer().size() == 0);
+}
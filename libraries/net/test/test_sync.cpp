@@ -0,0 +1,104 @@
+#include <psibase/cft.hpp>
+
+#include <psibase/log.hpp>
+#include <psibase/mock_routing.hpp>
+#include <psibase/mock_timer.hpp>
+#include <psibase/node.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <iostream>
+
+#include <catch2/catch.hpp>
+
+#include "test_util.hpp"
+
+using namespace psibase::net;
+using namespace psibase;
+using namespace psibase::test;
+using namespace std::literals::chrono_literals;
+
+using node_type = node<null_link, mock_routing, cft_consensus, ForkDb>;
+
+namespace
+{
+   // Builds a chain on one producer and peers-1 followers, then adds a
+   // new node that is connected to all of them. Returns the time it
+   // takes the new node to reach the commit index at the time it joined.
+   mock_clock::duration syncTime(std::size_t peers, bool rangeSync, std::uint64_t bandwidth)
+   {
+      boost::asio::io_context ctx;
+      NodeSet<node_type>      nodes(ctx);
+      setup<CftConsensus>(nodes, {"a"});
+      for (std::size_t i = 1; i < peers; ++i)
+         nodes.add(AccountNumber{std::string(1, 'a' + i)});
+      nodes.connect_all();
+      runFor(ctx, 5min);
+
+      for (auto& node : nodes.nodes)
+         node->node.network().bandwidth = bandwidth;
+      nodes.add(AccountNumber{"x"});
+      for (auto& node : nodes.nodes)
+         node->node.set_range_sync(rangeSync);
+      auto& fresh                    = *nodes.nodes.back();
+      fresh.node.network().bandwidth = bandwidth;
+      auto target                    = nodes[0].chain().commit_index();
+      nodes.connect_all(10ms);
+
+      auto start = mock_clock::now();
+      while (fresh.chain().get_head()->blockNum < target && mock_clock::now() < start + 10min)
+      {
+         mock_clock::advance();
+         ctx.poll();
+      }
+      CHECK(fresh.chain().get_head()->blockNum >= target);
+      return mock_clock::now() - start;
+   }
+}  // namespace
+
+TEST_CASE("range sync", "[cft]")
+{
+   TEST_START(logger);
+
+   boost::asio::io_context ctx;
+   NodeSet<node_type>      nodes(ctx);
+   setup<CftConsensus>(nodes, {"a"});
+   nodes.add(makeAccounts({"b", "c", "d"}));
+   nodes.connect_all();
+   runFor(ctx, 2min);
+
+   // The new node downloads the irreversible blocks from all four peers
+   nodes.add(AccountNumber{"x"});
+   for (auto& node : nodes.nodes)
+      node->node.set_range_sync(true);
+   auto& fresh = *nodes.nodes.back();
+   nodes.connect_all(10ms);
+   runFor(ctx, 10s);
+
+   std::size_t servers = 0;
+   for (const auto& [id, peer] : fresh.node.network()._peers)
+   {
+      if (peer.messages_sent.contains(GetBlocksRequest::type))
+         ++servers;
+   }
+   CHECK(servers > 1);
+
+   auto final_state = nodes[0].chain().get_head_state();
+   for (const auto& node : nodes.nodes)
+      CHECK(final_state->blockId() == node->chain().get_head_state()->blockId());
+   CHECK(final_state->info.header.commitNum >= final_state->info.header.blockNum - 2);
+}
+
+TEST_CASE("sync throughput", "[.][benchmark]")
+{
+   TEST_START(logger);
+
+   constexpr std::uint64_t bandwidth = 16 * 1024;
+   for (std::size_t peers : {1, 2, 4, 8})
+   {
+      auto pushed = syncTime(peers, false, bandwidth);
+      auto ranges = syncTime(peers, true, bandwidth);
+      std::cout << peers << " peers: push " << pushed / 1ms << " ms, range requests "
+                << ranges / 1ms << " ms" << std::endl;
+   }
+}
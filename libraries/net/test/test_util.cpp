@@ -74,7 +74,10 @@ std::vector<psibase::AccountNumber> makeAccounts(
    return result;
 }
 
-void boot(BlockContext* ctx, const Consensus& producers, bool ec)
+void boot(BlockContext*                      ctx,
+          const Consensus&                   producers,
+          bool                               ec,
+          const std::vector<GenesisService>& extraServices)
 {
    std::vector<GenesisService> services = {{
                                                .service = TransactionSys::service,
@@ -109,6 +112,7 @@ void boot(BlockContext* ctx, const Consensus& producers, bool ec)
           .code    = readWholeFile("VerifyEcSys.wasm"),
       });
    }
+   services.insert(services.end(), extraServices.begin(), extraServices.end());
    // TransactionSys + ProducerSys + AuthAnySys + AccountSys
    pushTransaction(ctx,
                    Transaction{                                                         //
@@ -150,7 +154,7 @@ static Tapos getTapos(const BlockInfo& info)
    return result;
 }
 
-static Tapos getTapos(psibase::BlockContext* ctx)
+Tapos getTapos(psibase::BlockContext* ctx)
 {
    Tapos result;
    result.expiration.seconds = ctx->current.header.time.seconds + 1;
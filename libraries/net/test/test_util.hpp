@@ -104,7 +104,7 @@ struct TempDatabase
          sharedState{std::make_shared<psibase::SharedState>(
              psibase::SharedDatabase{dir.path.native(), 1ull << 27, 1ull << 27, 1ull << 27,
                                      1ull << 27},
-             psibase::WasmCache{16})}
+             psibase::WasmCache{1ull << 27})}
    {
       dir.reset();
    }
@@ -308,7 +308,14 @@ std::ostream& operator<<(std::ostream& os, const NodeSet<Node>& nodes)
    return os;
 }
 
+// Reads a file relative to the working directory
+std::vector<char> readWholeFile(const std::filesystem::path& name);
+
 void pushTransaction(psibase::BlockContext* ctx, psibase::Transaction trx);
+// TAPoS that refers to the previous block of ctx
+psibase::Tapos getTapos(psibase::BlockContext* ctx);
+psibase::SignedTransaction signTransaction(const psibase::BlockInfo&   prevBlock,
+                                           const psibase::Transaction& trx);
 void setProducers(psibase::BlockContext* ctc, const psibase::Consensus& producers);
 
 psibase::Transaction setProducers(const psibase::Consensus& producers);
@@ -316,9 +323,11 @@ psibase::Transaction setProducers(const psibase::Consensus& producers);
 std::vector<psibase::AccountNumber> makeAccounts(
     const std::vector<std::string_view>& producer_names);
 
-void boot(psibase::BlockContext*    ctx,
-          const psibase::Consensus& producers,
-          bool                      enableEcdsa = false);
+// extraServices are installed along with the system services
+void boot(psibase::BlockContext*                      ctx,
+          const psibase::Consensus&                   producers,
+          bool                                        enableEcdsa   = false,
+          const std::vector<psibase::GenesisService>& extraServices = {});
 
 template <typename C>
 void boot(psibase::BlockContext* ctx, const std::vector<psibase::AccountNumber>& producers)
@@ -399,6 +408,8 @@ BlockMessage makeBlock(const BlockArg&                   info,
                        psibase::TermNum                  view,
                        const psibase::net::BlockConfirm& irreversible);
 
+std::vector<psibase::net::ProducerConfirm> makeProducerConfirms(
+    const std::vector<std::string_view>& names);
 psibase::net::BlockConfirm makeBlockConfirm(const BlockArg&                      committed,
                                             const std::vector<std::string_view>& prods,
                                             const std::vector<std::string_view>& next_prods);
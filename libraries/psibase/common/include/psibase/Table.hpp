@@ -121,6 +121,11 @@ namespace psibase
       {
          return {key.data() + prefix_size, key.size() - prefix_size};
       }
+      std::uint32_t open_cursor() const
+      {
+         check(!is_end, "cannot open a cursor at end");
+         return raw::kvIterOpen(db, key.data(), key.size(), prefix_size);
+      }
 
      private:
       void set(int sz)
@@ -231,7 +236,8 @@ namespace psibase
       /// Move iterator
       ///
       /// This moves the iterator to the most-recent location found by
-      /// [raw::kvGreaterEqual], [raw::kvLessThan], or [raw::kvMax].
+      /// [raw::kvGreaterEqual], [raw::kvLessThan], [raw::kvMax], [raw::kvIterNext],
+      /// or [raw::kvIterPrev].
       ///
       /// `result` is the return value of the raw call.
       ///
@@ -251,6 +257,14 @@ namespace psibase
       /// The returned value can be passed to `moveTo`, e.g. for GraphQL cursors.
       std::span<const char> keyWithoutPrefix() const { return base.keyWithoutPrefix(); }
 
+      /// Open a cursor positioned before this iterator
+      ///
+      /// The first [raw::kvIterNext] on the cursor finds this iterator's key. Passing
+      /// the results to `moveTo` walks the index without searching from the root for
+      /// each object, but the cursor does not see writes made after it was opened.
+      /// Close it with [kvIterClose]. The iterator must not be at the end.
+      std::uint32_t openCursor() const { return base.open_cursor(); }
+
       /// get object
       ///
       /// This reads an object from the database. It does not cache; it returns a fresh object
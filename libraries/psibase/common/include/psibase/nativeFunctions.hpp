@@ -124,6 +124,33 @@ namespace psibase
       /// and [getKey] to get found key.
       PSIBASE_NATIVE(kvMax) uint32_t kvMax(DbId db, const char* key, uint32_t keyLen);
 
+      /// Open an iterator positioned before the first key which is greater
+      /// than or equal to the provided key
+      ///
+      /// The iterator only visits keys whose first `matchKeySize` bytes match
+      /// the provided key. It sees the database as it was when it was opened.
+      /// Returns a handle for [kvIterNext], [kvIterPrev], and [kvIterClose].
+      /// At most 64 iterators may be open at once. Opening another aborts.
+      PSIBASE_NATIVE(kvIterOpen)
+      uint32_t kvIterOpen(DbId db, const char* key, uint32_t keyLen, uint32_t matchKeySize);
+
+      /// Advance an iterator past the next key-value pair
+      ///
+      /// If there is one, then sets result to value and returns size. Also sets
+      /// key. Otherwise returns `-1` and clears result. Use [getResult] to get
+      /// result and [getKey] to get found key.
+      PSIBASE_NATIVE(kvIterNext) uint32_t kvIterNext(uint32_t iterator);
+
+      /// Move an iterator back before the previous key-value pair
+      ///
+      /// If there is one, then sets result to value and returns size. Also sets
+      /// key. Otherwise returns `-1` and clears result. Use [getResult] to get
+      /// result and [getKey] to get found key.
+      PSIBASE_NATIVE(kvIterPrev) uint32_t kvIterPrev(uint32_t iterator);
+
+      /// Close an iterator. The handle may be reused by a later [kvIterOpen].
+      PSIBASE_NATIVE(kvIterClose) void kvIterClose(uint32_t iterator);
+
       /// Gets the current value of a clock in nanoseconds.
       ///
       /// This function is non-deterministic and is only available in subjective services.
@@ -529,6 +556,81 @@ namespace psibase
       return kvMax<V>(DbId::service, key);
    }
 
+   /// Open an iterator positioned before the first key which is greater
+   /// than or equal to `key`
+   ///
+   /// The iterator only visits keys whose first `matchKeySize` bytes match
+   /// `key`. Close it with [kvIterClose].
+   inline uint32_t kvIterOpenRaw(DbId db, psio::input_stream key, uint32_t matchKeySize)
+   {
+      return raw::kvIterOpen(db, key.pos, key.remaining(), matchKeySize);
+   }
+
+   /// Open an iterator positioned before the first key which is greater
+   /// than or equal to `key`
+   ///
+   /// The iterator only visits keys whose first `matchKeySize` bytes match
+   /// `key`. Close it with [kvIterClose].
+   template <typename K>
+   inline uint32_t kvIterOpen(DbId db, const K& key, uint32_t matchKeySize)
+   {
+      return kvIterOpenRaw(db, psio::convert_to_key(key), matchKeySize);
+   }
+
+   /// Advance an iterator past the next key-value pair
+   ///
+   /// If there is one, then returns the value. Use [getKey] to get the key.
+   inline std::optional<std::vector<char>> kvIterNextRaw(uint32_t iterator)
+   {
+      auto size = raw::kvIterNext(iterator);
+      if (size == -1)
+         return std::nullopt;
+      return getResult(size);
+   }
+
+   /// Advance an iterator past the next key-value pair
+   ///
+   /// If there is one, then returns the value. Use [getKey] to get the key.
+   template <typename V>
+   inline std::optional<V> kvIterNext(uint32_t iterator)
+   {
+      auto v = kvIterNextRaw(iterator);
+      if (!v)
+         return std::nullopt;
+      // TODO: validate (allow opt-in or opt-out)
+      return psio::from_frac<V>(psio::prevalidated{*v});
+   }
+
+   /// Move an iterator back before the previous key-value pair
+   ///
+   /// If there is one, then returns the value. Use [getKey] to get the key.
+   inline std::optional<std::vector<char>> kvIterPrevRaw(uint32_t iterator)
+   {
+      auto size = raw::kvIterPrev(iterator);
+      if (size == -1)
+         return std::nullopt;
+      return getResult(size);
+   }
+
+   /// Move an iterator back before the previous key-value pair
+   ///
+   /// If there is one, then returns the value. Use [getKey] to get the key.
+   template <typename V>
+   inline std::optional<V> kvIterPrev(uint32_t iterator)
+   {
+      auto v = kvIterPrevRaw(iterator);
+      if (!v)
+         return std::nullopt;
+      // TODO: validate (allow opt-in or opt-out)
+      return psio::from_frac<V>(psio::prevalidated{*v});
+   }
+
+   /// Close an iterator opened by [kvIterOpen]
+   inline void kvIterClose(uint32_t iterator)
+   {
+      raw::kvIterClose(iterator);
+   }
+
    /// Write `message` to console
    ///
    /// Message should be UTF8.
@@ -330,8 +330,15 @@ namespace psibase
       else
       {
          result.pageInfo.hasPreviousPage = it != rangeBegin;
-         for (; it != end && (!first || (*first)-- > 0); ++it)
-            add_edge(it);
+         if (it != end)
+         {
+            // Queries can't write, so a cursor sees the same rows as ++it
+            auto cursor = it.openCursor();
+            it.moveTo(raw::kvIterNext(cursor));
+            for (; it != end && (!first || (*first)-- > 0); it.moveTo(raw::kvIterNext(cursor)))
+               add_edge(it);
+            kvIterClose(cursor);
+         }
          result.pageInfo.hasNextPage = it != rangeEnd;
          if (last && *last < result.edges.size())
          {
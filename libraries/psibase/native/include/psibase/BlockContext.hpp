@@ -8,6 +8,8 @@
 
 namespace psibase
 {
+   class ProofPool;
+
    struct BlockContext
    {
       SystemContext&    systemContext;
@@ -24,6 +26,8 @@ namespace psibase
       bool              active            = false;
       //
       std::map<AccountNumber, bool> modifiedAuthAccounts;
+      // Code hashes of CodeByHashRows that were created in this block
+      std::vector<Checksum256> newCode;
 
       loggers::common_logger trxLogger;
 
@@ -32,8 +36,10 @@ namespace psibase
                    WriterPtr                       writer,
                    bool                            isProducing);
 
+      // Read-only mode. Queries should pass promoteReads = false.
       BlockContext(SystemContext&                  systemContext,
-                   std::shared_ptr<const Revision> revision);  // Read-only mode
+                   std::shared_ptr<const Revision> revision,
+                   bool                            promoteReads = true);
 
       void checkActive() { check(active, "block is not active"); }
 
@@ -64,6 +70,13 @@ namespace psibase
 
       void execAllInBlock();
 
+      // Executes the transactions speculatively on pool, each against the
+      // state at the start of the block, then commits them in block order.
+      // A transaction that read anything written by an earlier transaction
+      // in the block is executed again. The result is the same as
+      // execAllInBlock().
+      void execAllInBlock(ProofPool& pool);
+
       std::vector<std::vector<char>> exec(
           const SignedTransaction&                 trx,
           TransactionTrace&                        trace,
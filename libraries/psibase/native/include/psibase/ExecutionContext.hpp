@@ -1,6 +1,10 @@
 #pragma once
 
 #include <psibase/block.hpp>
+#include <psibase/db.hpp>
+
+#include <filesystem>
+#include <stop_token>
 
 namespace psibase
 {
@@ -14,17 +18,51 @@ namespace psibase
                 uint8_t            vmVersion,
                 psio::input_stream code);
 
+   struct WasmCacheStats
+   {
+      // Modules compiled by the first action that used them
+      std::uint64_t foregroundCompiles;
+      // Microseconds
+      std::int64_t foregroundCompileTime;
+      // Modules compiled before they were used
+      std::uint64_t backgroundCompiles;
+      // Microseconds
+      std::int64_t backgroundCompileTime;
+      std::size_t  pendingCompiles;
+      std::size_t  bytes;
+   };
+
    struct WasmCacheImpl;
    struct WasmCache
    {
       std::shared_ptr<WasmCacheImpl> impl;
 
-      WasmCache(uint32_t cacheSize);
+      // Evicts the least recently used modules when the compiled code
+      // takes more than cacheBytes
+      explicit WasmCache(std::size_t cacheBytes);
       WasmCache(const WasmCache&);
       WasmCache(WasmCache&&);
       ~WasmCache();
 
       std::vector<std::span<const char>> span() const;
+      std::size_t                        bytes() const;
+
+      // Records which modules are in the cache. eos-vm cannot reload
+      // compiled code, so the modules are compiled again by warm.
+      void save(const std::filesystem::path& file) const;
+
+      // Compiles the modules listed in a file written by save, using the
+      // code in the head revision. Returns the number of modules compiled.
+      std::size_t warm(SharedDatabase db, const std::filesystem::path& file, std::stop_token stop);
+
+      // Compiles code on a background thread, so that the first action
+      // which uses it does not wait for the compiler. The code is read
+      // from revision. Code which is already in the cache is skipped.
+      void compileAsync(SharedDatabase                  db,
+                        ConstRevisionPtr                revision,
+                        const std::vector<Checksum256>& codeHashes);
+
+      WasmCacheStats stats() const;
    };
 
    struct ExecutionMemoryImpl;
@@ -37,6 +75,10 @@ namespace psibase
       ~ExecutionMemory();
 
       std::span<const char> span() const;
+      // Makes at least the first bytes of linear memory accessible and
+      // touches every page, so that executing a service doesn't fault them
+      // in. Must be called before the memory is used.
+      void prefault(std::size_t bytes);
    };
 
    struct TransactionContext;
@@ -1,16 +1,22 @@
 #pragma once
 
+#include <atomic>
 #include <boost/container/flat_map.hpp>
 #include <boost/log/attributes/constant.hpp>
+#include <deque>
 #include <iostream>
+#include <list>
 #include <psibase/BlockContext.hpp>
+#include <psibase/ProofPool.hpp>
 #include <psibase/Prover.hpp>
+#include <psibase/VerifyCache.hpp>
 #include <psibase/VerifyProver.hpp>
 #include <psibase/block.hpp>
 #include <psibase/db.hpp>
 #include <psibase/log.hpp>
 
 #include <ranges>
+#include <span>
 
 namespace psibase
 {
@@ -570,6 +576,12 @@ namespace psibase
 
       void setTerm(TermNum term) { currentTerm = term; }
 
+      // Stops a fork switch that is in progress after the block that is
+      // executing. The head is left at the last block that was executed.
+      // Later fork switches stop immediately. This can be called from
+      // any thread.
+      void interrupt() { interrupted.store(true); }
+
       // \post fork switch needed
       // \post only blocks that are descendents of root will be considered
       // as the head block
@@ -716,15 +728,18 @@ namespace psibase
             --iter;
             if (iter->second == id)
             {
-               if (execute_fork(iter, byBlocknumIndex.end(), on_accept_block))
-               {
-                  head = new_head;
-                  assert(!!head->revision);
-                  return true;
-               }
-               else
+               switch (execute_fork(iter, byBlocknumIndex.end(), on_accept_block))
                {
-                  return false;
+                  case fork_result::success:
+                     head = new_head;
+                     assert(!!head->revision);
+                     return true;
+                  case fork_result::failure:
+                     return false;
+                  case fork_result::interrupted:
+                     // head is valid, but trying other forks would
+                     // only be interrupted again.
+                     return true;
                }
             }
             if (iter->first <= commitIndex)
@@ -742,88 +757,282 @@ namespace psibase
       // sends a correct block with the wrong signature.
       Claim validateBlockSignature(BlockHeaderState* prev, const BlockInfo& info, const auto& sig)
       {
-         BlockContext verifyBc(*systemContext, prev->authState->revision);
-         VerifyProver prover{verifyBc, sig};
-         auto         claim = prev->getNextProducerClaim(info.header.producer);
+         return validateBlockSignature(*systemContext, prev, info, sig);
+      }
+      // The signature of a block is checked when it is inserted and again
+      // when it is prepared for execution. The second check is usually
+      // answered by verifyCache.
+      Claim validateBlockSignature(SystemContext&    context,
+                                   BlockHeaderState* prev,
+                                   const BlockInfo&  info,
+                                   const auto&       sig)
+      {
+         auto claim = prev->getNextProducerClaim(info.header.producer);
          if (!claim)
          {
             throw std::runtime_error("Invalid producer for block");
          }
-         prover.prove(BlockSignatureInfo(info), *claim);
+         std::vector<char> proof    = sig;
+         const auto&       revision = prev->authState->revision;
+         verifyCached(context, revision, BlockSignatureInfo(info), *claim, proof);
          return std::move(*claim);
       }
-      // TODO: this can run concurrently.
-      void validateTransactionSignatures(const Block& b, const ConstRevisionPtr& revision)
+      // Verifies a signature unless verifyCache already has it. The chain
+      // thread reuses a BlockContext for each recent revision. Other
+      // threads build their own.
+      void verifyCached(SystemContext&           context,
+                        const ConstRevisionPtr&  revision,
+                        std::span<const char>    data,
+                        const Claim&             claim,
+                        const std::vector<char>& signature)
       {
-         BlockContext verifyBc(*systemContext, revision);
-         verifyBc.start(b.header.time);
-         for (const auto& trx : b.transactions)
+         auto key = VerifyCache::makeKey(revision, data, claim, signature);
+         if (verifyCache.contains(key))
+            return;
+         if (&context == systemContext)
          {
-            check(trx.proofs.size() == trx.transaction->claims().size(),
-                  "proofs and claims must have same size");
-            for (std::size_t i = 0; i < trx.proofs.size(); ++i)
+            VerifyProver prover{getVerifyContext(revision), signature};
+            prover.prove(data, claim);
+         }
+         else
+         {
+            BlockContext verifyBc(context, revision);
+            VerifyProver prover{verifyBc, signature};
+            prover.prove(data, claim);
+         }
+         verifyCache.insert(key, revision);
+      }
+      BlockContext& getVerifyContext(const ConstRevisionPtr& revision)
+      {
+         for (auto iter = verifyContexts.begin(); iter != verifyContexts.end(); ++iter)
+         {
+            if (iter->first == revision)
             {
-               TransactionTrace trace;
-               verifyBc.verifyProof(trx, trace, i, std::nullopt);
+               verifyContexts.splice(verifyContexts.begin(), verifyContexts, iter);
+               return verifyContexts.front().second;
             }
          }
+         verifyContexts.emplace_front(std::piecewise_construct, std::forward_as_tuple(revision),
+                                      std::forward_as_tuple(*systemContext, revision));
+         if (verifyContexts.size() > maxVerifyContexts)
+            verifyContexts.pop_back();
+         return verifyContexts.front().second;
+      }
+      static void validateTransactionSignatures(SystemContext&           context,
+                                                const Block&             b,
+                                                const ConstRevisionPtr&  revision,
+                                                const SignedTransaction& trx)
+      {
+         check(trx.proofs.size() == trx.transaction->claims().size(),
+               "proofs and claims must have same size");
+         if (trx.proofs.empty())
+            return;
+         BlockContext verifyBc(context, revision);
+         verifyBc.start(b.header.time);
+         for (std::size_t i = 0; i < trx.proofs.size(); ++i)
+         {
+            TransactionTrace trace;
+            verifyBc.verifyProof(trx, trace, i, std::nullopt);
+         }
       }
-      // \pre the state of prev has been set
-      bool execute_block(BlockHeaderState* prev, BlockHeaderState* state, auto&& on_accept_block)
+
+      // A block whose signature has been checked and which has been
+      // decoded, but which has not been executed yet. The signature only
+      // depends on the auth state of the previous block, which is known
+      // before the previous block executes, so this can run ahead of
+      // execution.
+      struct PreparedBlock
+      {
+         BlockHeaderState*                  prev;
+         BlockHeaderState*                  state;
+         psio::shared_view_ptr<SignedBlock> signedBlock;
+         bool                               started = false;
+         std::optional<Block>               block;
+         std::optional<Claim>               claim;
+         std::exception_ptr                 error;
+      };
+      void prepareBlock(SystemContext& context, PreparedBlock& p)
       {
-         std::error_code ec{};
-         if (!state->revision)
+         try
+         {
+            p.claim = validateBlockSignature(context, p.prev, p.state->info,
+                                             p.signedBlock->signature());
+            p.block.emplace(p.signedBlock->block());
+         }
+         catch (...)
+         {
+            p.error = std::current_exception();
+         }
+      }
+      // The maximum number of blocks that execute_fork prepares ahead of
+      // the block that is executing
+      static constexpr std::size_t syncLookahead = 16;
+
+      // Runs f(context, i) for i in [0, n), on the proof pool if there is
+      // one. With a pool, the work overlaps whatever the caller does until
+      // waitJobs. Without one, it all runs in waitJobs.
+      void startJobs(std::size_t n, ProofPool::Job f)
+      {
+         if (proofPool)
+            proofPool->start(n, std::move(f));
+         else
+            pendingJobs = {n, std::move(f)};
+      }
+      void waitJobs()
+      {
+         if (proofPool)
+            proofPool->wait(*systemContext);
+         else
          {
-            BlockContext ctx(*systemContext, prev->revision, writer, false);
-            auto         blockPtr = get(state->blockId());
-            PSIBASE_LOG_CONTEXT_BLOCK(blockLogger, state->info.header, state->blockId());
+            auto [n, f] = std::move(pendingJobs);
+            for (std::size_t i = 0; i < n; ++i)
+               f(*systemContext, i);
+         }
+      }
+
+      // \pre the state of p.prev has been set
+      //
+      // The transaction proofs of the block and the preparation of the
+      // blocks in lookahead run while the block executes. All proofs run
+      // against the previous block's revision, so they do not depend on
+      // the result of execution. If several checks fail, the error from
+      // the first transaction is reported, no matter which finished first.
+      bool execute_block(PreparedBlock&                  p,
+                         std::span<PreparedBlock* const> lookahead,
+                         auto&&                          on_accept_block)
+      {
+         auto* prev  = p.prev;
+         auto* state = p.state;
+         if (state->revision)
+            return true;
+         BlockContext ctx(*systemContext, prev->revision, writer, false);
+         PSIBASE_LOG_CONTEXT_BLOCK(blockLogger, state->info.header, state->blockId());
+         try
+         {
+            if (p.error)
+               std::rethrow_exception(p.error);
+            ctx.start(std::move(*p.block));
+            const auto& trxs = ctx.current.transactions;
+            std::vector<std::exception_ptr> errors(trxs.size());
+            startJobs(trxs.size() + lookahead.size(),
+                      [&](SystemContext& context, std::size_t i)
+                      {
+                         if (i >= trxs.size())
+                            return prepareBlock(context, *lookahead[i - trxs.size()]);
+                         try
+                         {
+                            validateTransactionSignatures(context, ctx.current, prev->revision,
+                                                          trxs[i]);
+                         }
+                         catch (...)
+                         {
+                            errors[i] = std::current_exception();
+                         }
+                      });
+            std::exception_ptr execError;
             try
             {
-               auto claim = validateBlockSignature(prev, state->info, blockPtr->signature());
-               ctx.start(Block(blockPtr->block()));
-               validateTransactionSignatures(ctx.current, prev->revision);
                ctx.callStartBlock();
-               ctx.execAllInBlock();
-               auto [newRevision, id] =
-                   ctx.writeRevision(FixedProver(blockPtr->signature()), claim);
-               // TODO: diff header fields
-               check(id == state->blockId(), "blockId does not match");
-               state->revision = newRevision;
-
-               on_accept_block(state);
-               PSIBASE_LOG(blockLogger, info) << "Accepted block";
+               if (execPool)
+                  ctx.execAllInBlock(*execPool);
+               else
+                  ctx.execAllInBlock();
             }
-            catch (std::exception& e)
+            catch (...)
             {
-               PSIBASE_LOG(blockLogger, warning) << e.what();
-               return false;
+               execError = std::current_exception();
             }
+            waitJobs();
+            for (auto& e : errors)
+               if (e)
+                  std::rethrow_exception(e);
+            if (execError)
+               std::rethrow_exception(execError);
+            auto [newRevision, id] =
+                ctx.writeRevision(FixedProver(p.signedBlock->signature()), *p.claim);
+            // TODO: diff header fields
+            check(id == state->blockId(), "blockId does not match");
+            state->revision = newRevision;
+
+            on_accept_block(state);
+            PSIBASE_LOG(blockLogger, info) << "Accepted block";
+         }
+         catch (std::exception& e)
+         {
+            PSIBASE_LOG(blockLogger, warning) << e.what();
+            return false;
          }
          return true;
       }
-      // TODO: run this in a separate thread and make it interruptable
-      bool execute_fork(auto iter, auto end, auto&& on_accept_block)
+      enum class fork_result
+      {
+         success,
+         failure,
+         interrupted,
+      };
+      // Executes the blocks after iter, keeping up to syncLookahead blocks
+      // prepared ahead of the block that is executing. If it is interrupted,
+      // head is left at the last block that was executed.
+      fork_result execute_fork(auto iter, auto end, auto&& on_accept_block)
       {
          if (iter != end)
          {
             auto* prev = get_state(iter->second);
             assert(prev->revision);
             ++iter;
+            // Holds the blocks in [iter, ahead). std::deque keeps the
+            // elements in place while the jobs fill them in.
+            std::deque<PreparedBlock>   window;
+            std::vector<PreparedBlock*> lookahead;
+            auto                        ahead = iter;
             for (; iter != end; ++iter)
             {
-               BlockHeaderState* nextState = get_state(iter->second);
-               if (!execute_block(prev, nextState, on_accept_block))
+               if (interrupted.load())
+               {
+                  byBlocknumIndex.erase(iter, end);
+                  head = prev;
+                  return fork_result::interrupted;
+               }
+               lookahead.clear();
+               while (ahead != end && window.size() <= syncLookahead)
+               {
+                  auto* s = get_state(ahead->second);
+                  window.push_back({window.empty() ? prev : window.back().state, s,
+                                    get(s->blockId())});
+                  ++ahead;
+               }
+               // Blocks that already have a revision are not executed again,
+               // so there is nothing to overlap with.
+               if (!window.front().state->revision)
+               {
+                  if (!window.front().started)
+                  {
+                     window.front().started = true;
+                     prepareBlock(*systemContext, window.front());
+                  }
+                  for (auto& p : window)
+                  {
+                     if (!p.started && !p.state->revision)
+                     {
+                        p.started = true;
+                        lookahead.push_back(&p);
+                     }
+                  }
+               }
+               BlockHeaderState* nextState = window.front().state;
+               if (!execute_block(window.front(), lookahead, on_accept_block))
                {
                   byBlocknumIndex.erase(iter, end);
                   blacklist_subtree(nextState);
                   head = prev;
-                  return false;
+                  return fork_result::failure;
                }
+               window.pop_front();
                systemContext->sharedDatabase.setHead(*writer, nextState->revision);
                prev = nextState;
             }
          }
-         return true;
+         return fork_result::success;
       }
       BlockHeaderState* get_state(const id_type& id)
       {
@@ -1072,9 +1281,14 @@ namespace psibase
       auto& getLogger() { return logger; }
       auto& getBlockLogger() { return blockLogger; }
 
+      // execPool runs the transactions in received blocks in parallel. It
+      // must not be the same pool as proofPool, which is busy with proofs
+      // while the block executes.
       explicit ForkDb(SystemContext*          sc,
-                      std::shared_ptr<Prover> prover = std::make_shared<CompoundProver>())
-          : prover{std::move(prover)}
+                      std::shared_ptr<Prover> prover    = std::make_shared<CompoundProver>(),
+                      ProofPool*              proofPool = nullptr,
+                      ProofPool*              execPool  = nullptr)
+          : prover{std::move(prover)}, proofPool{proofPool}, execPool{execPool}
       {
          logger.add_attribute("Channel", boost::log::attributes::constant(std::string("chain")));
          blockLogger.add_attribute("Channel",
@@ -1194,9 +1408,8 @@ namespace psibase
          check(stateIter != states.end(), "Unknown block");
          stateIter = states.find(stateIter->second.info.header.previous);
          check(stateIter != states.end(), "Previous block unknown");
-         BlockContext verifyBc(*systemContext, stateIter->second.authState->revision);
-         VerifyProver prover{verifyBc, signature};
-         prover.prove(data, claim);
+         verifyCached(*systemContext, stateIter->second.authState->revision, data, claim,
+                      signature);
       }
 
       void verify(std::span<char> data, const Claim& claim, const std::vector<char>& signature)
@@ -1208,9 +1421,7 @@ namespace psibase
          // We'd better have a state for this block
          assert(stateIter != states.end());
          assert(stateIter->second.revision);
-         BlockContext verifyBc(*systemContext, stateIter->second.revision);
-         VerifyProver prover{verifyBc, signature};
-         prover.prove(data, claim);
+         verifyCached(*systemContext, stateIter->second.revision, data, claim, signature);
       }
 
       void verify(ConstRevisionPtr         revision,
@@ -1218,16 +1429,55 @@ namespace psibase
                   const Claim&             claim,
                   const std::vector<char>& signature)
       {
-         BlockContext verifyBc(*systemContext, std::move(revision));
-         VerifyProver prover{verifyBc, signature};
-         prover.prove(data, claim);
+         verifyCached(*systemContext, revision, data, claim, signature);
+      }
+
+      struct SignatureCheck
+      {
+         std::span<const char>    data;
+         const Claim&             claim;
+         const std::vector<char>& signature;
+      };
+
+      // Verifies several signatures against the same revision. The checks
+      // run on the proof pool if there is one. If several checks fail, the
+      // error from the first one is reported.
+      void verify(const ConstRevisionPtr& revision, std::span<const SignatureCheck> checks)
+      {
+         std::vector<std::exception_ptr> errors(checks.size());
+         startJobs(checks.size(),
+                   [&](SystemContext& context, std::size_t i)
+                   {
+                      try
+                      {
+                         verifyCached(context, revision, checks[i].data, checks[i].claim,
+                                      checks[i].signature);
+                      }
+                      catch (...)
+                      {
+                         errors[i] = std::current_exception();
+                      }
+                   });
+         waitJobs();
+         for (auto& e : errors)
+            if (e)
+               std::rethrow_exception(e);
       }
 
      private:
       std::optional<BlockContext>                               blockContext;
+      // Read-only contexts for verifying signatures on the chain thread,
+      // most recently used first
+      std::list<std::pair<ConstRevisionPtr, BlockContext>>      verifyContexts;
+      static constexpr std::size_t                              maxVerifyContexts = 4;
+      VerifyCache                                               verifyCache;
       SystemContext*                                            systemContext = nullptr;
       WriterPtr                                                 writer;
       CheckedProver                                             prover;
+      ProofPool*                                                proofPool = nullptr;
+      ProofPool*                                                execPool  = nullptr;
+      std::pair<std::size_t, ProofPool::Job>                    pendingJobs;
+      std::atomic<bool>                                         interrupted{false};
       BlockNum                                                  commitIndex = 1;
       TermNum                                                   currentTerm = 1;
       BlockHeaderState*                                         head        = nullptr;
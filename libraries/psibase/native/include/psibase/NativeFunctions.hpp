@@ -22,6 +22,21 @@ namespace psibase
       std::vector<char> result_key;
       std::vector<char> result_value;
 
+      // Set by host functions which read or modify state outside of the
+      // wasm instance. ExecutionContext only snapshots an instance if its
+      // start function did not set this.
+      bool touchedState = false;
+
+      struct KvIterator
+      {
+         uint32_t                              db;
+         std::shared_ptr<Database::KVIterator> it;
+      };
+      std::vector<KvIterator> kvIterators;
+      // Each open iterator holds a snapshot of the database, so the number
+      // that may be open at once is limited.
+      static constexpr std::size_t maxKvIterators = 64;
+
       // TODO: delete range. Need some way for system services to enable/disable it
       //       since it's only compatible with some resource models
       // TODO: some way for transaction-sys to indicate auth failures.
@@ -51,6 +66,10 @@ namespace psibase
       uint32_t kvGreaterEqual(uint32_t db, eosio::vm::span<const char> key, uint32_t matchKeySize);
       uint32_t kvLessThan(uint32_t db, eosio::vm::span<const char> key, uint32_t matchKeySize);
       uint32_t kvMax(uint32_t db, eosio::vm::span<const char> key);
+      uint32_t kvIterOpen(uint32_t db, eosio::vm::span<const char> key, uint32_t matchKeySize);
+      uint32_t kvIterNext(uint32_t iterator);
+      uint32_t kvIterPrev(uint32_t iterator);
+      void     kvIterClose(uint32_t iterator);
       uint32_t kvGetTransactionUsage();
    };  // NativeFunctions
 }  // namespace psibase
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <psibase/SystemContext.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace psibase
+{
+   // Runs independent checks, such as transaction proofs, on several threads.
+   // Each worker holds a SystemContext from SharedState while it runs. The
+   // thread that calls run also works on the batch, using its own
+   // SystemContext, so a pool with no workers runs everything on the caller.
+   class ProofPool
+   {
+     public:
+      using Job = std::function<void(SystemContext&, std::size_t)>;
+
+      // Worker threads are named <name>-<n> and take their SystemContexts
+      // from pool
+      ProofPool(SharedState&      sharedState,
+                std::size_t       numThreads,
+                const char*       name = "proof",
+                SystemContextPool pool = SystemContextPool::proof);
+      ~ProofPool();
+
+      // Calls f(systemContext, i) for each i in [0, n) and returns after all
+      // calls have finished. f must not throw.
+      void run(SystemContext& context, std::size_t n, Job f);
+
+      // Like run, but returns immediately. The batch runs on the workers
+      // while the caller does something else. The same thread must call
+      // wait. A start on another thread blocks until then.
+      void start(std::size_t n, Job f);
+
+      // Works on the batch from start until it is finished
+      void wait(SystemContext& context);
+
+     private:
+      void drain(SystemContext& context, const Job& f, std::size_t n);
+      void worker(SystemContext& context);
+
+      std::mutex               mutex;
+      std::condition_variable  startCond;
+      std::condition_variable  idleCond;
+      Job                      job;
+      std::size_t              size       = 0;
+      std::atomic<std::size_t> next       = 0;
+      std::uint64_t            generation = 0;
+      std::size_t              active     = 0;
+      // Set from start until wait returns. Another start waits for it.
+      bool                     inBatch    = false;
+      bool                     done       = false;
+      std::vector<std::thread> threads;
+   };
+}  // namespace psibase
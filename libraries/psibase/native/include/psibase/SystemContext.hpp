@@ -6,6 +6,18 @@
 namespace psibase
 {
    struct WatchdogManager;
+   struct SystemContextRegistry;
+
+   // Each pool keeps its own idle SystemContexts. A burst of queries can't
+   // take the contexts, and the memories they have faulted in, that block
+   // production and proof verification use.
+   enum class SystemContextPool : std::uint8_t
+   {
+      block,
+      proof,
+      rpc,
+   };
+   inline constexpr std::size_t numSystemContextPools = 3;
 
    struct SystemContext
    {
@@ -13,17 +25,34 @@ namespace psibase
       WasmCache                        wasmCache;
       std::vector<ExecutionMemory>     executionMemories;
       std::shared_ptr<WatchdogManager> watchdogManager;
+      SystemContextPool                pool = SystemContextPool::block;
+      // Set when SharedState creates the context. SharedState reports the
+      // memories of the contexts in it until they are destroyed.
+      std::shared_ptr<SystemContextRegistry> registry;
+
+      ~SystemContext();
 
+      // Memories are never released here, because creating them again is
+      // expensive. TransactionContext enforces the configured limit.
       void setNumMemories(size_t n)
       {
-         if (n < executionMemories.size())
-            executionMemories.resize(n);
          executionMemories.reserve(n);
          while (n > executionMemories.size())
             executionMemories.push_back({});
       }
    };  // SystemContext
 
+   struct SystemContextPoolStats
+   {
+      // Calls to getSystemContext
+      std::uint64_t acquisitions;
+      // Contexts that were created because none were idle
+      std::uint64_t created;
+      // Microseconds spent in getSystemContext
+      std::int64_t waitTime;
+      std::size_t  idle;
+   };
+
    struct SharedStateImpl;
    struct SharedState
    {
@@ -33,10 +62,21 @@ namespace psibase
       ~SharedState();
 
       std::vector<std::span<const char>> dbSpan() const;
+      std::size_t                        dbPendingReleases() const;
       std::vector<std::span<const char>> codeSpan() const;
+      WasmCacheStats                     wasmCacheStats() const;
       std::vector<std::span<const char>> linearMemorySpan() const;
 
-      std::unique_ptr<SystemContext> getSystemContext();
-      void                           addSystemContext(std::unique_ptr<SystemContext> context);
+      std::unique_ptr<SystemContext> getSystemContext(
+          SystemContextPool pool = SystemContextPool::block);
+      // Returns the context to the pool that it came from
+      void addSystemContext(std::unique_ptr<SystemContext> context);
+      // Creates idle contexts ahead of time with as many memories as the
+      // chain is configured to use, and faults in the first prefaultBytes of
+      // each memory. The first users of the pool then don't pay for it.
+      void                   prewarm(SystemContextPool pool,
+                                     std::size_t       contexts,
+                                     std::size_t       prefaultBytes = 0);
+      SystemContextPoolStats poolStats(SystemContextPool pool) const;
    };
 }  // namespace psibase
@@ -53,7 +53,8 @@ namespace psibase
       void execTransaction();
 
       void execNonTrxAction(uint64_t callerFlags, const Action& act, ActionTrace& atrace);
-      void execCalledAction(uint64_t callerFlags, const Action& act, ActionTrace& atrace);
+      // Executes atrace.action
+      void execCalledAction(uint64_t callerFlags, ActionTrace& atrace);
       void execServe(const Action& act, ActionTrace& atrace);
 
       ExecutionContext& getExecutionContext(AccountNumber service);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <psibase/block.hpp>
+#include <psibase/db.hpp>
+
+#include <compare>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+
+namespace psibase
+{
+   // Remembers signatures that have already been verified. Consensus
+   // messages and blocks often arrive more than once, and each copy would
+   // otherwise run the verify service again.
+   //
+   // A result only holds for the revision that it was verified against,
+   // because the verify services and the keys are part of the state.
+   //
+   // All members may be called from any thread.
+   class VerifyCache
+   {
+     public:
+      struct Key
+      {
+         const Revision* revision;
+         Checksum256     hash;
+
+         friend auto operator<=>(const Key&, const Key&) = default;
+      };
+
+      explicit VerifyCache(std::size_t limit = 4096) : limit(limit) {}
+
+      static Key makeKey(const ConstRevisionPtr& revision,
+                         std::span<const char>   data,
+                         const Claim&            claim,
+                         std::span<const char>   signature);
+
+      bool contains(const Key& key) const;
+      // Records a successful verification. The oldest entry is dropped
+      // when the cache is full.
+      void insert(const Key& key, const ConstRevisionPtr& revision);
+
+     private:
+      mutable std::mutex mutex;
+      // The revision is held weakly, so that an entry never matches a new
+      // revision that happens to reuse the address of an old one.
+      std::map<Key, std::weak_ptr<const Revision>> entries;
+      std::deque<Key>                              order;
+      std::size_t                                  limit;
+   };
+}  // namespace psibase
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <vector>
 
@@ -24,24 +28,49 @@ namespace psibase
 
    class Watchdog;
 
+   // Each thread that creates a Watchdog gets its own slot in the manager.
+   // Watchdogs are armed and disarmed by writing to their slot, without
+   // locking. The manager thread polls the slots which have armed watchdogs
+   // and sleeps when there are none.
    class WatchdogManager
    {
      public:
       WatchdogManager();
       ~WatchdogManager();
 
+      // The longest that the manager sleeps while any watchdog is armed
+      static constexpr auto tick = std::chrono::milliseconds(1);
+
+      struct Slot;
+
      private:
       friend class Watchdog;
-      void                    add(Watchdog* wd);
-      void                    remove(Watchdog* wd);
-      void                    run();
-      std::mutex              mutex;
-      std::condition_variable cond;
-      std::vector<Watchdog*>  children;
-      bool                    done = false;
-      std::thread             worker;
+      using WakeClock = std::chrono::steady_clock;
+      // Values of wakeAt that are not times
+      static constexpr WakeClock::rep scanning = WakeClock::duration::min().count();
+      static constexpr WakeClock::rep idle     = WakeClock::duration::max().count();
+
+      std::shared_ptr<Slot> getSlot();
+      // Wakes the manager if a watchdog with the given remaining CPU time
+      // could expire before the manager's next scan
+      void                  wake(CpuClock::duration remaining);
+      // Returns the shortest remaining time of any armed watchdog. Called
+      // with mutex held.
+      std::optional<CpuClock::duration> scan();
+      void                              run();
+
+      const std::uint64_t                id;
+      std::mutex                         mutex;
+      std::condition_variable            cond;
+      std::vector<std::shared_ptr<Slot>> slots;
+      // When the manager will scan next
+      std::atomic<WakeClock::rep>        wakeAt{scanning};
+      bool                               woken = false;
+      bool                               done  = false;
+      std::thread                        worker;
    };
 
+   // A Watchdog must be used and destroyed on the thread that created it
    class Watchdog
    {
      public:
@@ -55,14 +84,20 @@ namespace psibase
 
      private:
       friend class WatchdogManager;
-      // Called with manager mutex held
-      CpuClock::duration    wait_duration();
-      WatchdogManager*      manager;
-      bool                  paused;
-      CpuClock::duration    elapsedOrStart;
-      CpuClock::duration    limit = CpuClock::duration::max();
-      clockid_t             cpuclock;
-      std::function<void()> handler;
+      // Publishes the deadline implied by paused, elapsedOrStart, and limit
+      void                                   arm();
+      WatchdogManager*                       manager;
+      std::shared_ptr<WatchdogManager::Slot> slot;
+      bool                                   paused;
+      CpuClock::duration                     elapsedOrStart;
+      CpuClock::duration                     limit = CpuClock::duration::max();
+      std::function<void()>                  handler;
+
+      // Read by the manager thread
+      std::atomic<CpuClock::rep> deadline{CpuClock::duration::max().count()};
+      std::atomic<Watchdog*>     next{nullptr};
+      // Only used by the manager thread
+      bool fired = false;
    };
 
 }  // namespace psibase
@@ -23,6 +23,17 @@ namespace psibase
    using Writer    = triedent::write_session;
    using WriterPtr = std::shared_ptr<Writer>;
 
+   // Storage policy for one DbId
+   struct DbPolicy
+   {
+      // Write new data directly to cold storage instead of the hot cache.
+      // This suits databases which are appended to and rarely read.
+      bool coldWrites = false;
+
+      // Copy data into the hot cache when it is read
+      bool promote = true;
+   };
+
    struct SharedDatabaseImpl;
    struct SharedDatabase
    {
@@ -33,7 +44,8 @@ namespace psibase
                      uint64_t                       hot_addr_bits  = 1ull << 32,
                      uint64_t                       warm_addr_bits = 1ull << 32,
                      uint64_t                       cool_addr_bits = 1ull << 32,
-                     uint64_t                       cold_addr_bits = 1ull << 32);
+                     uint64_t                       cold_addr_bits = 1ull << 32,
+                     bool                           perLevelSwap   = false);
       SharedDatabase(const SharedDatabase&) = default;
       SharedDatabase(SharedDatabase&&)      = default;
 
@@ -54,10 +66,28 @@ namespace psibase
       std::optional<std::vector<char>>   getBlockData(Writer&               writer,
                                                       const Checksum256&    blockId,
                                                       std::span<const char> key);
+      // Must be called before the database is shared with other threads
+      void                               setPolicy(DbId db, const DbPolicy& policy);
       bool                               isSlow() const;
+      std::size_t                        pendingReleases() const;
       std::vector<std::span<const char>> span() const;
    };
 
+   // Records the keys that a Database reads and writes. A range query is
+   // recorded as a read of every key that begins with its prefix.
+   struct AccessLog
+   {
+      struct Write
+      {
+         DbId                             db;
+         std::vector<char>                key;
+         std::optional<std::vector<char>> value;
+      };
+      std::vector<std::pair<DbId, std::vector<char>>> reads;
+      std::vector<std::pair<DbId, std::vector<char>>> prefixReads;
+      std::vector<Write>                              writes;
+   };
+
    struct DatabaseImpl;
    struct Database
    {
@@ -121,24 +151,44 @@ namespace psibase
       void             setRevision(ConstRevisionPtr revision);
       ConstRevisionPtr getBaseRevision();
       ConstRevisionPtr getModifiedRevision();
-      Session          startRead();
+      // Queries should pass promote = false, so that reading old or rarely
+      // used data doesn't evict the working set from the hot cache
+      Session          startRead(bool promote = true);
       Session          startWrite(WriterPtr writer);
       void             commit(Session& session);
       ConstRevisionPtr writeRevision(Session& session, const Checksum256& blockId);
       void             abort(Session&);
 
+      // Every access until the next call is appended to log. Pass nullptr
+      // to stop recording.
+      void setAccessLog(AccessLog* log);
+
       // TODO: kvPutRaw, kvRemoveRaw: return deltas
       // TODO: getters: pass in input buffers instead of returning KVResult
 
       void kvPutRaw(DbId db, psio::input_stream key, psio::input_stream value);
       void kvRemoveRaw(DbId db, psio::input_stream key);
       std::optional<psio::input_stream> kvGetRaw(DbId db, psio::input_stream key);
+      // Copies the value straight from the database into value. Unlike the
+      // overload above, this doesn't go through an intermediate buffer.
+      bool kvGetRaw(DbId db, psio::input_stream key, std::vector<char>& value);
       std::optional<KVResult>           kvGreaterEqualRaw(DbId               db,
                                                           psio::input_stream key,
                                                           size_t             matchKeySize);
       std::optional<KVResult> kvLessThanRaw(DbId db, psio::input_stream key, size_t matchKeySize);
       std::optional<KVResult> kvMaxRaw(DbId db, psio::input_stream key);
 
+      // An iterator sits in the gap between two keys. It starts before the
+      // first key >= key and only visits keys which begin with the first
+      // matchKeySize bytes of key. Iterators see the database as it was when
+      // they were opened and must not outlive the current session.
+      struct KVIterator;
+      std::shared_ptr<KVIterator> kvIterOpenRaw(DbId               db,
+                                                psio::input_stream key,
+                                                size_t             matchKeySize);
+      std::optional<KVResult>     kvIterNextRaw(KVIterator& it);
+      std::optional<KVResult>     kvIterPrevRaw(KVIterator& it);
+
       template <typename K, typename V>
       auto kvPut(DbId db, const K& key, const V& value)
           -> std::enable_if_t<!psio::is_std_optional<V>(), void>
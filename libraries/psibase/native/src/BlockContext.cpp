@@ -1,5 +1,10 @@
+#include <psibase/ProofPool.hpp>
 #include <psibase/TransactionContext.hpp>
 #include <psibase/serviceEntry.hpp>
+#include <psio/finally.hpp>
+
+#include <mutex>
+#include <set>
 
 namespace psibase
 {
@@ -18,10 +23,11 @@ namespace psibase
    }
 
    BlockContext::BlockContext(psibase::SystemContext&         systemContext,
-                              std::shared_ptr<const Revision> revision)
+                              std::shared_ptr<const Revision> revision,
+                              bool                            promoteReads)
        : systemContext{systemContext},
          db{systemContext.sharedDatabase, std::move(revision)},
-         session{db.startRead()},
+         session{db.startRead(promoteReads)},
          isProducing{true},  // a read_only block is never replayed
          isReadOnly{true}
    {
@@ -290,7 +296,10 @@ namespace psibase
       db.kvPut(DbId::blockProof, current.header.blockNum,
                prover.prove(BlockSignatureInfo(*status->head), claim));
 
-      return {session.writeRevision(status->head->blockId), status->head->blockId};
+      auto revision = session.writeRevision(status->head->blockId);
+      if (!newCode.empty())
+         systemContext.wasmCache.compileAsync(systemContext.sharedDatabase, revision, newCode);
+      return {std::move(revision), status->head->blockId};
    }
 
    void BlockContext::verifyProof(const SignedTransaction&                 trx,
@@ -364,6 +373,151 @@ namespace psibase
       }
    }
 
+   namespace
+   {
+      // The outcome of running a transaction against the state at the
+      // start of the block
+      struct SpeculativeResult
+      {
+         bool                          ok = false;
+         AccessLog                     log;
+         DatabaseStatusRow             databaseStatus;
+         std::map<AccountNumber, bool> modifiedAuthAccounts;
+         std::vector<Checksum256>      newCode;
+      };
+
+      using WrittenKeys = std::set<std::pair<DbId, std::vector<char>>>;
+
+      bool startsWith(const std::vector<char>& key, const std::vector<char>& prefix)
+      {
+         return key.size() >= prefix.size() &&
+                std::equal(prefix.begin(), prefix.end(), key.begin());
+      }
+
+      bool conflicts(const AccessLog& log, const WrittenKeys& written)
+      {
+         for (const auto& read : log.reads)
+            if (written.contains(read))
+               return true;
+         for (const auto& [db, prefix] : log.prefixReads)
+         {
+            auto it = written.lower_bound({db, prefix});
+            if (it != written.end() && it->first == db && startsWith(it->second, prefix))
+               return true;
+         }
+         // putSequential updates the counters in BlockContext::databaseStatus
+         // without reading the row, so writing the row depends on it.
+         auto statusKey = psio::convert_to_key(DatabaseStatusRow::key());
+         for (const auto& write : log.writes)
+            if (write.db == DatabaseStatusRow::db && write.key == statusKey &&
+                written.contains({write.db, write.key}))
+               return true;
+         return false;
+      }
+   }  // namespace
+
+   void BlockContext::execAllInBlock(ProofPool& pool)
+   {
+      auto n = current.transactions.size();
+      if (n < 2)
+         return execAllInBlock();
+      checkActive();
+
+      auto                           base = db.getModifiedRevision();
+      std::vector<SpeculativeResult> results(n);
+      std::mutex                     writerMutex;
+      std::vector<WriterPtr>         writers;
+
+      pool.run(systemContext, n,
+               [&](SystemContext& context, std::size_t i)
+               {
+                  auto& trx    = current.transactions[i];
+                  auto& result = results[i];
+                  try
+                  {
+                     WriterPtr specWriter;
+                     {
+                        std::lock_guard lock{writerMutex};
+                        if (!writers.empty())
+                        {
+                           specWriter = std::move(writers.back());
+                           writers.pop_back();
+                        }
+                     }
+                     if (!specWriter)
+                        specWriter = context.sharedDatabase.createWriter();
+                     auto returnWriter = psio::finally{[&]
+                                                       {
+                                                          std::lock_guard lock{writerMutex};
+                                                          writers.push_back(specWriter);
+                                                       }};
+
+                     BlockContext spec{context, base, specWriter, false};
+                     spec.current.header = current.header;
+                     spec.databaseStatus = databaseStatus;
+                     spec.started        = true;
+                     spec.active         = true;
+                     spec.db.setAccessLog(&result.log);
+
+                     check(!!trx.subjectiveData, "Missing subjective data");
+                     check(!(trx.transaction->tapos().flags() & Tapos::do_not_broadcast_flag),
+                           "cannot commit a do_not_broadcast transaction");
+                     TransactionTrace   trace;
+                     TransactionContext t{spec, trx, trace, true, true, false};
+                     t.execTransaction();
+                     check(t.nextSubjectiveRead == trx.subjectiveData->size(),
+                           "transaction has unread subjective data");
+
+                     spec.db.setAccessLog(nullptr);
+                     result.databaseStatus       = spec.databaseStatus;
+                     result.modifiedAuthAccounts = std::move(spec.modifiedAuthAccounts);
+                     result.newCode              = std::move(spec.newCode);
+                     result.ok                   = true;
+                  }
+                  catch (...)
+                  {
+                     result.ok = false;
+                  }
+               });
+
+      auto        statusKey = psio::convert_to_key(DatabaseStatusRow::key());
+      WrittenKeys written;
+      for (std::size_t i = 0; i < n; ++i)
+      {
+         auto& trx    = current.transactions[i];
+         auto& result = results[i];
+         if (result.ok && !conflicts(result.log, written))
+         {
+            BOOST_LOG_SCOPED_THREAD_TAG("TransactionId",
+                                        sha256(trx.transaction.data(), trx.transaction.size()));
+            for (auto& write : result.log.writes)
+            {
+               if (write.value)
+                  db.kvPutRaw(write.db, write.key, *write.value);
+               else
+                  db.kvRemoveRaw(write.db, write.key);
+               if (write.db == DatabaseStatusRow::db && write.key == statusKey)
+                  databaseStatus = result.databaseStatus;
+            }
+            for (const auto& [account, isAuth] : result.modifiedAuthAccounts)
+               modifiedAuthAccounts[account] = isAuth;
+            newCode.insert(newCode.end(), result.newCode.begin(), result.newCode.end());
+            PSIBASE_LOG(trxLogger, info) << "Transaction succeeded";
+         }
+         else
+         {
+            check(!!trx.subjectiveData, "Missing subjective data");
+            result.log = {};
+            db.setAccessLog(&result.log);
+            auto             resetLog = psio::finally{[&] { db.setAccessLog(nullptr); }};
+            TransactionTrace trace;
+            exec(trx, trace, std::nullopt, false, true);
+         }
+         for (auto& write : result.log.writes)
+            written.insert({write.db, std::move(write.key)});
+      }
+   }
+
    std::vector<std::vector<char>> BlockContext::exec(
        const SignedTransaction&                 trx,
        TransactionTrace&                        trace,
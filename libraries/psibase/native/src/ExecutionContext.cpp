@@ -1,16 +1,24 @@
 #include <psibase/NativeFunctions.hpp>
 
+#include <algorithm>
 #include <atomic>
 #include <boost/multi_index/key.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index_container.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <debug_eos_vm/debug_eos_vm.hpp>
+#include <deque>
 #include <eosio/vm/backend.hpp>
+#include <fstream>
 #include <mutex>
 #include <psibase/ActionContext.hpp>
 #include <psibase/db.hpp>
 #include <psio/from_bin.hpp>
+#include <pthread.h>
+#include <thread>
 
 namespace bmi = boost::multi_index;
 
@@ -72,6 +80,76 @@ namespace psibase
       database.kvPut(CodeByHashRow::db, codeObj->key(), *codeObj);
    }  // setCode
 
+   using GlobalValue = decltype(std::declval<backend_t&>().get_module().globals[0].current);
+
+   // The state of an instance after its start function returned, stored
+   // as the pages which start changed. Restoring a snapshot on top of a
+   // freshly initialized instance is equivalent to running start again,
+   // as long as start did not use any host functions which depend on state
+   // outside of the instance.
+   struct InstanceSnapshot
+   {
+      static constexpr std::size_t chunkSize = 4096;
+
+      AccountNumber service;
+      // start succeeded with this call depth limit, so it would also
+      // succeed with any larger limit.
+      std::uint32_t            maxCallDepth;
+      std::uint32_t            pages;
+      std::vector<std::size_t> chunkOffsets;
+      std::vector<char>        chunks;
+      std::vector<GlobalValue> globals;
+
+      std::size_t bytes() const
+      {
+         return chunks.size() + chunkOffsets.size() * sizeof(std::size_t) +
+                globals.size() * sizeof(GlobalValue);
+      }
+
+      // initial holds the linear memory right after initialize
+      InstanceSnapshot(AccountNumber              service,
+                       std::uint32_t              maxCallDepth,
+                       std::span<const char>      initial,
+                       eosio::vm::wasm_allocator& wa,
+                       const auto&                module)
+          : service{service}, maxCallDepth{maxCallDepth}, pages(wa.get_current_page())
+      {
+         const char* base = wa.get_base_ptr<const char>();
+         std::size_t size = std::size_t(pages) * eosio::vm::page_size;
+         for (std::size_t offset = 0; offset < size; offset += chunkSize)
+         {
+            std::size_t n = std::min(chunkSize, size - offset);
+            if (offset + n <= initial.size() &&
+                std::memcmp(base + offset, initial.data() + offset, n) == 0)
+               continue;
+            if (offset >= initial.size() && std::all_of(base + offset, base + offset + n,
+                                                        [](char ch) { return ch == 0; }))
+               continue;
+            chunkOffsets.push_back(offset);
+            chunks.insert(chunks.end(), base + offset, base + offset + n);
+         }
+         for (const auto& global : module.globals)
+            globals.push_back(global.current);
+      }
+
+      void restore(eosio::vm::wasm_allocator& wa, auto& module) const
+      {
+         if (auto current = wa.get_current_page(); std::uint32_t(current) < pages)
+            wa.alloc<char>(pages - current);
+         char*       base = wa.get_base_ptr<char>();
+         std::size_t size = std::size_t(pages) * eosio::vm::page_size;
+         const char* data = chunks.data();
+         for (auto offset : chunkOffsets)
+         {
+            std::size_t n = std::min(chunkSize, size - offset);
+            std::memcpy(base + offset, data, n);
+            data += n;
+         }
+         for (std::size_t i = 0; i < globals.size(); ++i)
+            module.globals[i].current = globals[i];
+      }
+   };
+
    struct BackendEntry
    {
       Checksum256                hash;
@@ -80,10 +158,80 @@ namespace psibase
 #ifdef __x86_64__
       std::shared_ptr<dwarf::debugger_registration> debug;
 #endif
+      // The memory used by the module and its compiled code
+      std::size_t bytes = 0;
+      // One for each service that runs this code
+      std::vector<InstanceSnapshot> snapshots;
+      // Cleared when start uses state outside the instance. There is no
+      // point in copying the memory for a snapshot after that.
+      bool snapshottable = true;
+
+      const InstanceSnapshot* getSnapshot(AccountNumber service, std::uint32_t maxCallDepth) const
+      {
+         for (const auto& snapshot : snapshots)
+            if (snapshot.service == service && snapshot.maxCallDepth <= maxCallDepth)
+               return &snapshot;
+         return nullptr;
+      }
+
+      void addSnapshot(InstanceSnapshot&& snapshot)
+      {
+         bytes += snapshot.bytes();
+         for (auto& existing : snapshots)
+         {
+            if (existing.service == snapshot.service)
+            {
+               bytes -= existing.bytes();
+               existing = std::move(snapshot);
+               return;
+            }
+         }
+         snapshots.push_back(std::move(snapshot));
+      }
 
       auto byHash() const { return std::tie(hash, vmOptions); }
    };
 
+   BackendEntry compile(const Checksum256&          hash,
+                        const VMOptions&            vmOptions,
+                        const std::vector<uint8_t>& code)
+   {
+      BackendEntry result{hash, vmOptions};
+      rethrowVMExcept(
+          [&]
+          {
+             psio::input_stream s{reinterpret_cast<const char*>(code.data()), code.size()};
+#ifdef __x86_64__
+             if (dwarf::has_debug_info(s))
+             {
+                debug_eos_vm::debug_instr_map debug;
+                result.backend = std::make_unique<backend_t>(code, nullptr, vmOptions, debug);
+                auto info      = dwarf::get_info_from_wasm(s);
+                result.debug   = dwarf::register_with_debugger(info, debug.locs,
+                                                               result.backend->get_module(), s);
+             }
+             else
+             {
+                result.backend = std::make_unique<backend_t>(code, nullptr, vmOptions);
+                result.debug   = dwarf::register_with_debugger(result.backend->get_module());
+             }
+#else
+             result.backend = std::make_unique<backend_t>(code, nullptr, vmOptions);
+#endif
+          });
+      auto& alloc  = result.backend->get_module().allocator;
+      result.bytes = alloc._capacity + alloc._code_size;
+      return result;
+   }
+
+   // The cache index which is saved across restarts
+   struct WasmCacheEntry
+   {
+      Checksum256 codeHash;
+      VMOptions   vmOptions;
+   };
+   PSIO_REFLECT(WasmCacheEntry, codeHash, vmOptions)
+
    struct ByAge;
    struct ByHash;
 
@@ -92,21 +240,125 @@ namespace psibase
        bmi::indexed_by<bmi::sequenced<bmi::tag<ByAge>>,
                        bmi::ordered_non_unique<bmi::tag<ByHash>, bmi::key<&BackendEntry::byHash>>>>;
 
+   struct CompileRequest
+   {
+      SharedDatabase   db;
+      ConstRevisionPtr revision;
+      Checksum256      codeHash;
+   };
+
    struct WasmCacheImpl
    {
       std::mutex       mutex;
-      uint32_t         cacheSize;
+      std::size_t      cacheBytes;
+      std::size_t      totalBytes = 0;
       BackendContainer backends;
 
-      WasmCacheImpl(uint32_t cacheSize) : cacheSize{cacheSize} {}
+      std::atomic<std::uint64_t> compiles[2]     = {};
+      std::atomic<std::int64_t>  compileTimes[2] = {};
+
+      // Background compilation. The thread starts when the first request
+      // arrives.
+      std::mutex                 queueMutex;
+      std::condition_variable    queueCond;
+      std::deque<CompileRequest> queue;
+      bool                       stopping = false;
+      std::thread                compileThread;
+
+      WasmCacheImpl(std::size_t cacheBytes) : cacheBytes{cacheBytes} {}
+
+      ~WasmCacheImpl()
+      {
+         {
+            std::lock_guard lock{queueMutex};
+            stopping = true;
+         }
+         queueCond.notify_one();
+         if (compileThread.joinable())
+            compileThread.join();
+      }
+
+      BackendEntry compile(const Checksum256&          hash,
+                           const VMOptions&            vmOptions,
+                           const std::vector<uint8_t>& code,
+                           bool                        background)
+      {
+         auto start  = std::chrono::steady_clock::now();
+         auto result = psibase::compile(hash, vmOptions, code);
+         auto time   = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - start);
+         compiles[background].fetch_add(1, std::memory_order_relaxed);
+         compileTimes[background].fetch_add(time.count(), std::memory_order_relaxed);
+         return result;
+      }
+
+      void push(std::vector<CompileRequest>&& requests)
+      {
+         {
+            std::lock_guard lock{queueMutex};
+            for (auto& request : requests)
+               queue.push_back(std::move(request));
+            if (!compileThread.joinable())
+               compileThread = std::thread{[this] { compileLoop(); }};
+         }
+         queueCond.notify_one();
+      }
+
+      std::size_t pending()
+      {
+         std::lock_guard lock{queueMutex};
+         return queue.size();
+      }
+
+      void compileLoop()
+      {
+         pthread_setname_np(pthread_self(), "wasm-compile");
+         std::unique_lock lock{queueMutex};
+         while (true)
+         {
+            queueCond.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (stopping)
+               return;
+            auto request = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            try
+            {
+               Database db{request.db, request.revision};
+               auto     session = db.startRead(false);
+               auto     config  = db.kvGetOrDefault<WasmConfigRow>(
+                   WasmConfigRow::db, WasmConfigRow::key(transactionWasmConfigTable));
+               if (!contains(request.codeHash, config.vmOptions))
+               {
+                  auto row = db.kvGet<CodeByHashRow>(CodeByHashRow::db,
+                                                     codeByHashKey(request.codeHash, 0, 0));
+                  if (row)
+                     add(compile(request.codeHash, config.vmOptions, row->code, true));
+               }
+            }
+            catch (std::exception&)
+            {
+               // The code will be compiled again when it is used, and the
+               // error will be reported to the transaction that uses it.
+            }
+            request = {};
+            lock.lock();
+         }
+      }
 
       void add(BackendEntry&& entry)
       {
+         if (!entry.backend)
+            return;
          std::lock_guard<std::mutex> lock{mutex};
          auto&                       ind = backends.get<ByAge>();
+         totalBytes += entry.bytes;
          ind.push_back(std::move(entry));
-         while (ind.size() > cacheSize)
+         while (totalBytes > cacheBytes)
+         {
+            totalBytes -= ind.front().bytes;
             ind.pop_front();
+         }
       }
 
       BackendEntry get(const Checksum256& hash, const VMOptions& vmOptions)
@@ -119,12 +371,23 @@ namespace psibase
             return result;
          ind.modify(it, [&](auto& x) { result = std::move(x); });
          ind.erase(it);
+         totalBytes -= result.bytes;
          result.backend->get_module().allocator.enable_code(true);
          return result;
       }
+
+      bool contains(const Checksum256& hash, const VMOptions& vmOptions)
+      {
+         std::lock_guard<std::mutex> lock{mutex};
+         auto&                       ind = backends.get<ByHash>();
+         return ind.find(std::tie(hash, vmOptions)) != ind.end();
+      }
    };
 
-   WasmCache::WasmCache(uint32_t cacheSize) : impl{std::make_shared<WasmCacheImpl>(cacheSize)} {}
+   WasmCache::WasmCache(std::size_t cacheBytes)
+       : impl{std::make_shared<WasmCacheImpl>(cacheBytes)}
+   {
+   }
 
    WasmCache::WasmCache(const WasmCache& src) : impl{src.impl} {}
 
@@ -132,6 +395,89 @@ namespace psibase
 
    WasmCache::~WasmCache() {}
 
+   std::size_t WasmCache::bytes() const
+   {
+      std::lock_guard lock{impl->mutex};
+      return impl->totalBytes;
+   }
+
+   WasmCacheStats WasmCache::stats() const
+   {
+      return {.foregroundCompiles    = impl->compiles[0].load(std::memory_order_relaxed),
+              .foregroundCompileTime = impl->compileTimes[0].load(std::memory_order_relaxed),
+              .backgroundCompiles    = impl->compiles[1].load(std::memory_order_relaxed),
+              .backgroundCompileTime = impl->compileTimes[1].load(std::memory_order_relaxed),
+              .pendingCompiles       = impl->pending(),
+              .bytes                 = bytes()};
+   }
+
+   void WasmCache::compileAsync(SharedDatabase                  db,
+                                ConstRevisionPtr                revision,
+                                const std::vector<Checksum256>& codeHashes)
+   {
+      std::vector<CompileRequest> requests;
+      for (const auto& codeHash : codeHashes)
+         requests.push_back({db, revision, codeHash});
+      impl->push(std::move(requests));
+   }
+
+   void WasmCache::save(const std::filesystem::path& file) const
+   {
+      std::vector<WasmCacheEntry> entries;
+      {
+         std::lock_guard lock{impl->mutex};
+         for (const auto& backend : impl->backends)
+            entries.push_back({backend.hash, backend.vmOptions});
+      }
+      auto data = psio::to_frac(entries);
+      auto tmp  = file;
+      tmp += ".tmp";
+      {
+         std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+         out.write(data.data(), data.size());
+         if (!out)
+            throw std::runtime_error("Failed to write " + tmp.native());
+      }
+      std::filesystem::rename(tmp, file);
+   }
+
+   std::size_t WasmCache::warm(SharedDatabase                db,
+                               const std::filesystem::path& file,
+                               std::stop_token              stop)
+   {
+      std::vector<char> data;
+      {
+         std::ifstream in(file, std::ios::binary);
+         if (!in)
+            return 0;
+         data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+      }
+      auto entries = psio::from_frac<std::vector<WasmCacheEntry>>(data);
+
+      Database    database{db, db.getHead()};
+      std::size_t result = 0;
+      // The file lists the least recently used code first, so adding the
+      // entries in order also restores their order in the cache.
+      for (const auto& [codeHash, vmOptions] : entries)
+      {
+         if (stop.stop_requested())
+            break;
+         if (impl->contains(codeHash, vmOptions))
+            continue;
+         std::optional<CodeByHashRow> row;
+         {
+            auto session = database.startRead();
+            row = database.kvGet<CodeByHashRow>(CodeByHashRow::db, codeByHashKey(codeHash, 0, 0));
+         }
+         // The code may have been removed since the file was saved
+         if (!row)
+            continue;
+         impl->add(impl->compile(codeHash, vmOptions, row->code, true));
+         ++result;
+      }
+      return result;
+   }
+
    std::vector<std::span<const char>> WasmCache::span() const
    {
       std::vector<std::span<const char>> result;
@@ -169,6 +515,16 @@ namespace psibase
       return {raw - syspagesize, eosio::vm::max_memory + 2 * syspagesize};
    }
 
+   void ExecutionMemory::prefault(std::size_t bytes)
+   {
+      auto pages = (bytes + eosio::vm::page_size - 1) / eosio::vm::page_size;
+      if (auto current = impl->wa.get_current_page(); std::size_t(current) < pages)
+         impl->wa.alloc<char>(pages - current);
+      // Instantiating a module resets the allocator to the module's initial
+      // size. The pages stay resident.
+      std::memset(impl->wa.get_base_ptr<char>(), 0, pages * eosio::vm::page_size);
+   }
+
    // TODO: debugger
    struct ExecutionContextImpl : NativeFunctions
    {
@@ -198,35 +554,11 @@ namespace psibase
          check(c.has_value(), "service code record is missing");
          check(c->vmType == 0, "vmType is not 0");
          check(c->vmVersion == 0, "vmVersion is not 0");
-         rethrowVMExcept(
-             [&]
-             {
-                backend = transactionContext.blockContext.systemContext.wasmCache.impl->get(
-                    code.codeHash, vmOptions);
-                if (!backend.backend)
-                {
-                   psio::input_stream s{reinterpret_cast<const char*>(c->code.data()),
-                                        c->code.size()};
-#ifdef __x86_64__
-                   if (dwarf::has_debug_info(s))
-                   {
-                      debug_eos_vm::debug_instr_map debug;
-                      backend.backend =
-                          std::make_unique<backend_t>(c->code, nullptr, vmOptions, debug);
-                      auto info     = dwarf::get_info_from_wasm(s);
-                      backend.debug = dwarf::register_with_debugger(
-                          info, debug.locs, backend.backend->get_module(), s);
-                   }
-                   else
-                   {
-                      backend.backend = std::make_unique<backend_t>(c->code, nullptr, vmOptions);
-                      backend.debug = dwarf::register_with_debugger(backend.backend->get_module());
-                   }
-#else
-                   backend.backend = std::make_unique<backend_t>(c->code, nullptr, vmOptions);
-#endif
-                }
-             });
+         backend = transactionContext.blockContext.systemContext.wasmCache.impl->get(
+             code.codeHash, vmOptions);
+         if (!backend.backend)
+            backend = transactionContext.blockContext.systemContext.wasmCache.impl->compile(
+                code.codeHash, vmOptions, c->code, false);
       }
 
       ~ExecutionContextImpl()
@@ -242,11 +574,29 @@ namespace psibase
              [&]
              {
                 // auto startTime = std::chrono::steady_clock::now();
+                auto  service      = currentActContext->action.service;
+                auto  maxCallDepth = currentActContext->transactionContext.remainingStack;
+                auto& module       = backend.backend->get_module();
                 backend.backend->set_wasm_allocator(&wa);
                 backend.backend->initialize(getAltStack(), this);
-                (*backend.backend)(getAltStack(), *this, "env", "start",
-                                   currentActContext->action.service.value);
+                if (auto* snapshot = backend.getSnapshot(service, maxCallDepth))
+                {
+                   snapshot->restore(wa, module);
+                   initialized = true;
+                   return;
+                }
+                std::vector<char> initial;
+                if (backend.snapshottable)
+                   initial.assign(wa.get_base_ptr<const char>(),
+                                  wa.get_base_ptr<const char>() +
+                                      std::size_t(wa.get_current_page()) * eosio::vm::page_size);
+                touchedState = false;
+                (*backend.backend)(getAltStack(), *this, "env", "start", service.value);
                 initialized = true;
+                if (touchedState)
+                   backend.snapshottable = false;
+                else if (backend.snapshottable)
+                   backend.addSnapshot({service, maxCallDepth, initial, wa, module});
                 // auto us     = std::chrono::duration_cast<std::chrono::microseconds>(
                 //     std::chrono::steady_clock::now() - startTime);
                 // std::cout << "init:   " << us.count() << " us\n";
@@ -315,6 +665,10 @@ namespace psibase
       rhf_t::add<&ExecutionContextImpl::kvGreaterEqual>("env", "kvGreaterEqual");
       rhf_t::add<&ExecutionContextImpl::kvLessThan>("env", "kvLessThan");
       rhf_t::add<&ExecutionContextImpl::kvMax>("env", "kvMax");
+      rhf_t::add<&ExecutionContextImpl::kvIterOpen>("env", "kvIterOpen");
+      rhf_t::add<&ExecutionContextImpl::kvIterNext>("env", "kvIterNext");
+      rhf_t::add<&ExecutionContextImpl::kvIterPrev>("env", "kvIterPrev");
+      rhf_t::add<&ExecutionContextImpl::kvIterClose>("env", "kvIterClose");
       // rhf_t::add<&ExecutionContextImpl::kvGetTransactionUsage>("env", "kvGetTransactionUsage");
    }
 
@@ -11,6 +11,7 @@ namespace psibase
       template <typename F>
       auto timeDb(NativeFunctions& self, F f)
       {
+         self.touchedState = true;
          auto start  = std::chrono::steady_clock::now();
          auto result = f();
          self.currentActContext->transactionContext.databaseTime +=
@@ -21,6 +22,7 @@ namespace psibase
       template <typename F>
       void timeDbVoid(NativeFunctions& self, F f)
       {
+         self.touchedState = true;
          auto start = std::chrono::steady_clock::now();
          f();
          self.currentActContext->transactionContext.databaseTime +=
@@ -197,7 +199,10 @@ namespace psibase
          //ctx.incCode(code.codeHash(), code.vmType(), code.vmVersion(), -1);
       }
 
-      void verifyCodeByHashRow(psio::input_stream key, psio::input_stream value)
+      void verifyCodeByHashRow(TransactionContext&               ctx,
+                               psio::input_stream                key,
+                               psio::input_stream                value,
+                               std::optional<psio::input_stream> oldValue)
       {
          check(psio::fracpack_validate_strict<CodeByHashRow>({value.pos, value.end}),
                "CodeByHashRow has invalid format");
@@ -210,6 +215,8 @@ namespace psibase
          check(key.remaining() == expected_key.size() &&
                    !memcmp(key.pos, expected_key.data(), key.remaining()),
                "CodeByHashRow has incorrect key");
+         if (!oldValue)
+            ctx.blockContext.newCode.push_back(code.codeHash);
       }
 
       void verifyConfigRow(psio::input_stream key, psio::input_stream value)
@@ -254,7 +261,7 @@ namespace psibase
          if (table == codeTable)
             verifyCodeRow(context, key, value, existing);
          else if (table == codeByHashTable)
-            verifyCodeByHashRow(key, value);
+            verifyCodeByHashRow(context, key, value, existing);
          else if (table == configTable)
             verifyConfigRow(key, value);
          else if (table == transactionWasmConfigTable || table == proofWasmConfigTable)
@@ -277,6 +284,7 @@ namespace psibase
 
       uint32_t clearResult(NativeFunctions& self)
       {
+         self.touchedState = true;
          self.result_key.clear();
          self.result_value.clear();
          return -1;
@@ -284,6 +292,7 @@ namespace psibase
 
       uint32_t setResult(NativeFunctions& self, std::vector<char> result)
       {
+         self.touchedState = true;
          self.result_key.clear();
          self.result_value = std::move(result);
          return self.result_value.size();
@@ -298,6 +307,14 @@ namespace psibase
          return self.result_value.size();
       }
 
+      uint32_t setResult(NativeFunctions& self, Database& database, DbId db, psio::input_stream key)
+      {
+         if (!database.kvGetRaw(db, key, self.result_value))
+            return clearResult(self);
+         self.result_key.clear();
+         return self.result_value.size();
+      }
+
       uint32_t setResult(NativeFunctions& self, const std::optional<Database::KVResult>& o)
       {
          if (!o)
@@ -325,6 +342,7 @@ namespace psibase
 
    void NativeFunctions::writeConsole(eosio::vm::span<const char> str)
    {
+      touchedState = true;
       // TODO: limit total console size across all executions within transaction
       if (currentActContext->actionTrace.innerTraces.empty() ||
           !std::holds_alternative<ConsoleTrace>(
@@ -422,17 +440,23 @@ namespace psibase
       remainingStack -= VMOptions::stack_usage_for_call;
       currentActContext->transactionContext.remainingStack = remainingStack;
 
-      // TODO: don't unpack rawData
       check(psio::fracpack_validate_strict<Action>(data), "call: invalid data format");
-      auto act = psio::from_frac<Action>(psio::prevalidated{data});
-      check(act.sender == code.codeNum || (code.flags & CodeRow::allowSudo),
+      auto act = psio::view<const Action>(psio::prevalidated{data});
+      check(act.sender() == code.codeNum || (code.flags & CodeRow::allowSudo),
             "service is not authorized to call as another sender");
 
       currentActContext->actionTrace.innerTraces.push_back({ActionTrace{}});
       auto& inner_action_trace =
           std::get<ActionTrace>(currentActContext->actionTrace.innerTraces.back().inner);
-      // TODO: avoid reserialization
-      currentActContext->transactionContext.execCalledAction(code.flags, act, inner_action_trace);
+      // The trace holds the only copy of the action. The caller's memory
+      // can't be used after this, because the callee may be the same service.
+      auto& action   = inner_action_trace.action;
+      auto  rawData  = act.rawData();
+      action.sender  = act.sender();
+      action.service = act.service();
+      action.method  = act.method();
+      action.rawData.assign(rawData.data(), rawData.data() + rawData.size());
+      currentActContext->transactionContext.execCalledAction(code.flags, inner_action_trace);
       setResult(*this, inner_action_trace.rawRetval);
 
       currentActContext->transactionContext.remainingStack = saved;
@@ -551,8 +575,7 @@ namespace psibase
       return timeDb(  //
           *this,
           [&] {
-             return setResult(*this,
-                              database.kvGetRaw(getDbRead(*this, db), {key.data(), key.size()}));
+             return setResult(*this, database, getDbRead(*this, db), {key.data(), key.size()});
           });
    }
 
@@ -563,7 +586,7 @@ namespace psibase
           [&]
           {
              auto m = getDbReadSequential(*this, db);
-             return setResult(*this, database.kvGetRaw(m, psio::convert_to_key(indexNumber)));
+             return setResult(*this, database, m, psio::convert_to_key(indexNumber));
           });
    }
 
@@ -616,6 +639,65 @@ namespace psibase
           });
    }
 
+   uint32_t NativeFunctions::kvIterOpen(uint32_t                    db,
+                                        eosio::vm::span<const char> key,
+                                        uint32_t                    matchKeySize)
+   {
+      return timeDb(  //
+          *this,
+          [&]
+          {
+             check(matchKeySize <= key.size(), "matchKeySize is larger than key");
+             if (keyHasServicePrefix(db))
+                check(matchKeySize >= sizeof(AccountNumber::value),
+                      "matchKeySize is smaller than 8 bytes");
+             auto pos = std::find_if(kvIterators.begin(), kvIterators.end(),
+                                     [](auto& i) { return !i.it; });
+             check(pos != kvIterators.end() || kvIterators.size() < maxKvIterators,
+                   "too many open kv iterators");
+             auto it = database.kvIterOpenRaw(getDbRead(*this, db), {key.data(), key.size()},
+                                              matchKeySize);
+             if (pos == kvIterators.end())
+                pos = kvIterators.emplace(pos);
+             *pos = {db, std::move(it)};
+             return uint32_t(pos - kvIterators.begin());
+          });
+   }
+
+   uint32_t NativeFunctions::kvIterNext(uint32_t iterator)
+   {
+      return timeDb(  //
+          *this,
+          [&]
+          {
+             check(iterator < kvIterators.size() && kvIterators[iterator].it,
+                   "invalid kv iterator");
+             auto& i = kvIterators[iterator];
+             getDbRead(*this, i.db);
+             return setResult(*this, database.kvIterNextRaw(*i.it));
+          });
+   }
+
+   uint32_t NativeFunctions::kvIterPrev(uint32_t iterator)
+   {
+      return timeDb(  //
+          *this,
+          [&]
+          {
+             check(iterator < kvIterators.size() && kvIterators[iterator].it,
+                   "invalid kv iterator");
+             auto& i = kvIterators[iterator];
+             getDbRead(*this, i.db);
+             return setResult(*this, database.kvIterPrevRaw(*i.it));
+          });
+   }
+
+   void NativeFunctions::kvIterClose(uint32_t iterator)
+   {
+      check(iterator < kvIterators.size() && kvIterators[iterator].it, "invalid kv iterator");
+      kvIterators[iterator].it.reset();
+   }
+
    // TODO: return an extensible struct instead of a vector.
    //       maybe include intrinsic usage so transact-sys can veto?
    uint32_t NativeFunctions::kvGetTransactionUsage()
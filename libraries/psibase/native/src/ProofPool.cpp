@@ -0,0 +1,101 @@
+#include <psibase/ProofPool.hpp>
+
+#include <cassert>
+#include <pthread.h>
+#include <string>
+
+namespace psibase
+{
+   ProofPool::ProofPool(SharedState&      sharedState,
+                        std::size_t       numThreads,
+                        const char*       name,
+                        SystemContextPool pool)
+   {
+      for (std::size_t i = 0; i < numThreads; ++i)
+      {
+         threads.emplace_back(
+             [this, &sharedState, i, name, pool]
+             {
+                pthread_setname_np(pthread_self(), (name + ("-" + std::to_string(i))).c_str());
+                auto context = sharedState.getSystemContext(pool);
+                worker(*context);
+                sharedState.addSystemContext(std::move(context));
+             });
+      }
+   }
+
+   ProofPool::~ProofPool()
+   {
+      {
+         std::lock_guard lock{mutex};
+         done = true;
+      }
+      startCond.notify_all();
+      for (auto& t : threads)
+         t.join();
+   }
+
+   void ProofPool::run(SystemContext& context, std::size_t n, Job f)
+   {
+      start(n, std::move(f));
+      wait(context);
+   }
+
+   void ProofPool::start(std::size_t n, Job f)
+   {
+      {
+         std::unique_lock lock{mutex};
+         // Workers which are still looking at the previous batch use next
+         idleCond.wait(lock, [&] { return !inBatch && active == 0; });
+         inBatch = true;
+         job     = std::move(f);
+         size    = n;
+         next.store(0);
+         ++generation;
+      }
+      startCond.notify_all();
+   }
+
+   void ProofPool::wait(SystemContext& context)
+   {
+      drain(context, job, size);
+      {
+         std::unique_lock lock{mutex};
+         assert(inBatch);
+         idleCond.wait(lock, [&] { return active == 0; });
+         job     = nullptr;
+         inBatch = false;
+      }
+      idleCond.notify_all();
+   }
+
+   void ProofPool::drain(SystemContext& context, const Job& f, std::size_t n)
+   {
+      for (std::size_t i; (i = next.fetch_add(1)) < n;)
+         f(context, i);
+   }
+
+   void ProofPool::worker(SystemContext& context)
+   {
+      std::uint64_t    seen = 0;
+      std::unique_lock lock{mutex};
+      while (true)
+      {
+         startCond.wait(lock, [&] { return done || generation != seen; });
+         if (done)
+            return;
+         seen = generation;
+         // The batch finished before this worker woke up
+         if (!job)
+            continue;
+         auto* f = &job;
+         auto  n = size;
+         ++active;
+         lock.unlock();
+         drain(context, *f, n);
+         lock.lock();
+         if (--active == 0)
+            idleCond.notify_all();
+      }
+   }
+}  // namespace psibase
@@ -1,28 +1,120 @@
 #include <psibase/ActionContext.hpp>
 #include <psibase/Watchdog.hpp>
+#include <psibase/nativeTables.hpp>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <mutex>
+#include <thread>
 
 namespace psibase
 {
-   struct SharedStateImpl
+   namespace
+   {
+      // Idle contexts are spread over several free lists. A thread returns
+      // its context to its own list and usually gets the same context back
+      // next time, without contending with other threads.
+      constexpr std::size_t numShards = 8;
+
+      std::size_t currentShard()
+      {
+         return std::hash<std::thread::id>{}(std::this_thread::get_id()) % numShards;
+      }
+
+      struct ContextShard
+      {
+         std::mutex                                  mutex;
+         std::vector<std::unique_ptr<SystemContext>> idle;
+      };
+
+      struct ContextPool
+      {
+         std::array<ContextShard, numShards> shards;
+         std::atomic<std::uint64_t>          acquisitions{0};
+         std::atomic<std::uint64_t>          created{0};
+         std::atomic<std::int64_t>           waitTime{0};
+         std::atomic<std::size_t>            idle{0};
+
+         std::unique_ptr<SystemContext> pop()
+         {
+            auto first = currentShard();
+            for (std::size_t i = 0; i < numShards; ++i)
+            {
+               auto&           shard = shards[(first + i) % numShards];
+               std::lock_guard lock{shard.mutex};
+               if (!shard.idle.empty())
+               {
+                  auto result = std::move(shard.idle.back());
+                  shard.idle.pop_back();
+                  --idle;
+                  return result;
+               }
+            }
+            return nullptr;
+         }
+
+         void push(std::unique_ptr<SystemContext> context)
+         {
+            auto&           shard = shards[currentShard()];
+            std::lock_guard lock{shard.mutex};
+            shard.idle.push_back(std::move(context));
+            ++idle;
+         }
+      };
+   }  // namespace
+
+   // Every SystemContext that SharedState created and that still exists,
+   // whether it is idle or in use
+   struct SystemContextRegistry
    {
-      // TODO: need to redo cache since numExecutionMemories varies
-      std::mutex                                  mutex;
-      SharedDatabase                              db;
-      WasmCache                                   wasmCache;
-      std::vector<std::unique_ptr<SystemContext>> systemContextCache;
-      std::shared_ptr<WatchdogManager>            watchdogManager;
+      std::mutex                  mutex;
+      std::vector<SystemContext*> contexts;
 
-      // TODO: This assumes that systemContexts are always returned to the cache
-      std::vector<SystemContext*> allSystemContexts;
+      void add(SystemContext* context)
+      {
+         std::lock_guard lock{mutex};
+         contexts.push_back(context);
+      }
+
+      void remove(SystemContext* context)
+      {
+         std::lock_guard lock{mutex};
+         std::erase(contexts, context);
+      }
+   };
+
+   SystemContext::~SystemContext()
+   {
+      if (registry)
+         registry->remove(this);
+   }
+
+   struct SharedStateImpl
+   {
+      SharedDatabase                         db;
+      WasmCache                              wasmCache;
+      std::shared_ptr<WatchdogManager>       watchdogManager;
+      std::shared_ptr<SystemContextRegistry> registry;
+      ContextPool                            pools[numSystemContextPools];
 
       SharedStateImpl(SharedDatabase db, WasmCache wasmCache)
           : db{std::move(db)},
             wasmCache{std::move(wasmCache)},
-            watchdogManager(std::make_shared<WatchdogManager>())
+            watchdogManager(std::make_shared<WatchdogManager>()),
+            registry(std::make_shared<SystemContextRegistry>())
       {
       }
+
+      std::unique_ptr<SystemContext> create(SystemContextPool pool)
+      {
+         // Not make_unique, because SystemContext can't be moved
+         std::unique_ptr<SystemContext> result{
+             new SystemContext{db, wasmCache, {}, watchdogManager, pool, registry}};
+         registry->add(result.get());
+         return result;
+      }
    };
 
    SharedState::SharedState(SharedDatabase db, WasmCache wasmCache)
@@ -37,16 +129,26 @@ namespace psibase
       return impl->db.span();
    }
 
+   std::size_t SharedState::dbPendingReleases() const
+   {
+      return impl->db.pendingReleases();
+   }
+
    std::vector<std::span<const char>> SharedState::codeSpan() const
    {
       return impl->wasmCache.span();
    }
 
+   WasmCacheStats SharedState::wasmCacheStats() const
+   {
+      return impl->wasmCache.stats();
+   }
+
    std::vector<std::span<const char>> SharedState::linearMemorySpan() const
    {
-      std::lock_guard                    lock{impl->mutex};
+      std::lock_guard                    lock{impl->registry->mutex};
       std::vector<std::span<const char>> result;
-      for (auto* ctx : impl->allSystemContexts)
+      for (auto* ctx : impl->registry->contexts)
       {
          for (const auto& memory : ctx->executionMemories)
          {
@@ -56,24 +158,62 @@ namespace psibase
       return result;
    }
 
-   std::unique_ptr<SystemContext> SharedState::getSystemContext()
+   std::unique_ptr<SystemContext> SharedState::getSystemContext(SystemContextPool pool)
    {
-      std::lock_guard<std::mutex> lock{impl->mutex};
-      if (impl->systemContextCache.empty())
+      auto  start  = std::chrono::steady_clock::now();
+      auto& p      = impl->pools[(int)pool];
+      auto  result = p.pop();
+      if (!result)
       {
-         auto result = std::make_unique<SystemContext>(
-             SystemContext{impl->db, impl->wasmCache, {}, impl->watchdogManager});
-         impl->allSystemContexts.push_back(result.get());
-         return result;
+         result = impl->create(pool);
+         ++p.created;
       }
-      auto result = std::move(impl->systemContextCache.back());
-      impl->systemContextCache.pop_back();
+      ++p.acquisitions;
+      p.waitTime += std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
       return result;
    }
 
    void SharedState::addSystemContext(std::unique_ptr<SystemContext> context)
    {
-      std::lock_guard<std::mutex> lock{impl->mutex};
-      impl->systemContextCache.push_back(std::move(context));
+      impl->pools[(int)context->pool].push(std::move(context));
+   }
+
+   void SharedState::prewarm(SystemContextPool pool,
+                             std::size_t       contexts,
+                             std::size_t       prefaultBytes)
+   {
+      auto          table = pool == SystemContextPool::proof ? proofWasmConfigTable
+                                                             : transactionWasmConfigTable;
+      WasmConfigRow config;
+      {
+         Database db{impl->db, impl->db.getHead()};
+         auto     session = db.startRead();
+         config = db.kvGetOrDefault<WasmConfigRow>(WasmConfigRow::db, WasmConfigRow::key(table));
+      }
+      for (std::size_t i = 0; i < contexts; ++i)
+      {
+         auto context = impl->create(pool);
+         context->setNumMemories(config.numExecutionMemories);
+         if (prefaultBytes)
+         {
+            for (auto& memory : context->executionMemories)
+               memory.prefault(prefaultBytes);
+         }
+         ++impl->pools[(int)pool].created;
+         addSystemContext(std::move(context));
+      }
+   }
+
+   SystemContextPoolStats SharedState::poolStats(SystemContextPool pool) const
+   {
+      const auto& p = impl->pools[(int)pool];
+      return {
+          .acquisitions = p.acquisitions.load(),
+          .created      = p.created.load(),
+          .waitTime     = p.waitTime.load(),
+          .idle         = p.idle.load(),
+      };
    }
 }  // namespace psibase
@@ -134,14 +134,13 @@ namespace psibase
       ProcessTransactionArgs args{.transaction           = self.signedTransaction.transaction,
                                   .checkFirstAuthAndExit = checkFirstAuthAndExit};
 
-      Action action{
+      auto& atrace  = self.transactionTrace.actionTraces.emplace_back();
+      atrace.action = {
           .sender  = AccountNumber(),
           .service = transactionServiceNum,
           .rawData = psio::convert_to_frac(args),
       };
-      auto& atrace  = self.transactionTrace.actionTraces.emplace_back();
-      atrace.action = action;  // TODO: avoid copy and redundancy between action and atrace.action
-      ActionContext ac = {self, action, self.transactionTrace.actionTraces.back()};
+      ActionContext ac = {self, atrace.action, atrace};
       auto&         ec = self.getExecutionContext(transactionServiceNum);
       ec.execProcessTransaction(ac);
    }
@@ -173,15 +172,14 @@ namespace psibase
           .claim           = std::move(claim),
           .proof           = std::move(proof),
       };
-      Action action{
+      auto& atrace  = transactionTrace.actionTraces.emplace_back();
+      atrace.action = {
           .sender  = {},
           .service = data.claim.service,
           .rawData = psio::convert_to_frac(data),
       };
-      auto& atrace     = transactionTrace.actionTraces.emplace_back();
-      atrace.action    = action;
-      ActionContext ac = {*this, action, atrace};
-      auto&         ec = getExecutionContext(action.service);
+      ActionContext ac = {*this, atrace.action, atrace};
+      auto&         ec = getExecutionContext(atrace.action.service);
       ec.execVerify(ac);
    }
 
@@ -202,13 +200,10 @@ namespace psibase
       ec.execCalled(callerFlags, ac);
    }
 
-   void TransactionContext::execCalledAction(uint64_t      callerFlags,
-                                             const Action& action,
-                                             ActionTrace&  atrace)
+   void TransactionContext::execCalledAction(uint64_t callerFlags, ActionTrace& atrace)
    {
-      atrace.action    = action;
-      ActionContext ac = {*this, action, atrace};
-      auto&         ec = getExecutionContext(action.service);
+      ActionContext ac = {*this, atrace.action, atrace};
+      auto&         ec = getExecutionContext(atrace.action.service);
       ec.execCalled(callerFlags, ac);
    }
 
@@ -234,7 +229,7 @@ namespace psibase
       if (it != impl->executionContexts.end())
          return it->second;
       impl->watchdog.pause();
-      check(impl->executionContexts.size() < blockContext.systemContext.executionMemories.size(),
+      check(impl->executionContexts.size() < impl->wasmConfig.numExecutionMemories,
             "exceeded maximum number of running services");
       auto& memory = blockContext.systemContext.executionMemories[impl->executionContexts.size()];
       ExecutionContext            execContext{*this, impl->wasmConfig.vmOptions, memory, service};
@@ -0,0 +1,40 @@
+#include <psibase/VerifyCache.hpp>
+
+#include <tuple>
+
+namespace psibase
+{
+   VerifyCache::Key VerifyCache::makeKey(const ConstRevisionPtr& revision,
+                                         std::span<const char>   data,
+                                         const Claim&            claim,
+                                         std::span<const char>   signature)
+   {
+      return {revision.get(),
+              sha256(std::tuple(sha256(data.data(), data.size()), claim,
+                                std::vector<char>(signature.begin(), signature.end())))};
+   }
+
+   bool VerifyCache::contains(const Key& key) const
+   {
+      std::lock_guard l{mutex};
+      auto            pos = entries.find(key);
+      return pos != entries.end() && !pos->second.expired();
+   }
+
+   void VerifyCache::insert(const Key& key, const ConstRevisionPtr& revision)
+   {
+      std::lock_guard l{mutex};
+      auto [pos, inserted] = entries.try_emplace(key, revision);
+      if (!inserted)
+      {
+         pos->second = revision;
+         return;
+      }
+      order.push_back(key);
+      if (order.size() > limit)
+      {
+         entries.erase(order.front());
+         order.pop_front();
+      }
+   }
+}  // namespace psibase
@@ -1,6 +1,8 @@
 #include <psibase/Watchdog.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <pthread.h>
 #include <system_error>
 
 namespace psibase
@@ -16,100 +18,204 @@ namespace psibase
       return time_point(duration(static_cast<rep>(result.tv_sec) * 1000000000 + result.tv_nsec));
    }
 
-   WatchdogManager::WatchdogManager() : worker{[this] { run(); }} {}
+   struct WatchdogManager::Slot
+   {
+      clockid_t cpuclock;
+      // Watchdogs that were created by the thread, most recent first. Only
+      // the owning thread modifies the list.
+      std::atomic<Watchdog*> head{nullptr};
+      // Set while the manager walks the list. A watchdog that was unlinked
+      // can't be freed until this is clear.
+      std::atomic<bool> scanning{false};
+      std::atomic<bool> exited{false};
+      std::atomic<bool> managerGone{false};
+   };
+
+   namespace
+   {
+      std::atomic<std::uint64_t> nextManagerId{0};
+
+      // The slots that belong to the current thread
+      struct ThreadSlots
+      {
+         struct Entry
+         {
+            std::uint64_t                          managerId;
+            std::shared_ptr<WatchdogManager::Slot> slot;
+         };
+         std::vector<Entry> entries;
+         ~ThreadSlots()
+         {
+            for (auto& entry : entries)
+               entry.slot->exited.store(true);
+         }
+      };
+   }  // namespace
+
+   WatchdogManager::WatchdogManager() : id{nextManagerId.fetch_add(1)}, worker{[this] { run(); }}
+   {
+   }
    WatchdogManager::~WatchdogManager()
    {
       {
          std::lock_guard l{mutex};
          done = true;
+         for (auto& slot : slots)
+            slot->managerGone.store(true);
       }
       cond.notify_one();
       worker.join();
    }
-   void WatchdogManager::add(Watchdog* wd)
+
+   std::shared_ptr<WatchdogManager::Slot> WatchdogManager::getSlot()
    {
-      std::lock_guard l{mutex};
-      children.push_back(wd);
-      cond.notify_one();
+      static thread_local ThreadSlots threadSlots;
+      auto&                           entries = threadSlots.entries;
+      std::erase_if(entries, [](const auto& entry) { return entry.slot->managerGone.load(); });
+      for (const auto& entry : entries)
+      {
+         if (entry.managerId == id)
+            return entry.slot;
+      }
+      auto slot = std::make_shared<Slot>();
+      if (int err = pthread_getcpuclockid(pthread_self(), &slot->cpuclock))
+      {
+         throw std::system_error(err, std::system_category());
+      }
+      {
+         std::lock_guard l{mutex};
+         slots.push_back(slot);
+      }
+      entries.push_back({id, slot});
+      return slot;
    }
-   void WatchdogManager::remove(Watchdog* wd)
+
+   void WatchdogManager::wake(CpuClock::duration remaining)
    {
-      std::lock_guard l{mutex};
-      auto            pos = std::find(children.begin(), children.end(), wd);
-      if (pos != children.end())
-         children.erase(pos);
+      auto next = wakeAt.load();
+      if (next != scanning && next != idle &&
+          remaining >= WakeClock::duration{next} - WakeClock::now().time_since_epoch())
+         return;
+      {
+         std::lock_guard l{mutex};
+         woken = true;
+      }
+      cond.notify_one();
    }
-   void WatchdogManager::run()
+
+   std::optional<CpuClock::duration> WatchdogManager::scan()
    {
-      std::unique_lock l{mutex};
-      while (!done)
+      std::optional<CpuClock::duration> earliest;
+      std::erase_if(slots, [](const auto& slot) { return slot->exited.load(); });
+      for (auto& slot : slots)
       {
-         auto iter = children.begin();
-         // Limit the maximum wait to avoid integer overflow in wait_for
-         CpuClock::duration earliest = std::chrono::days(1);
-         for (Watchdog* child : children)
+         std::optional<CpuClock::rep> now;
+         slot->scanning.store(true);
+         for (Watchdog* wd = slot->head.load(); wd; wd = wd->next.load())
          {
-            auto remaining = child->wait_duration();
+            auto deadline = wd->deadline.load();
+            if (deadline == CpuClock::duration::max().count() || wd->fired)
+               continue;
+            if (!now)
+               now = CpuClock::now(slot->cpuclock).time_since_epoch().count();
+            auto remaining = CpuClock::duration{deadline - *now};
             if (remaining.count() < 0)
             {
-               child->interrupt();
+               wd->fired = true;
+               wd->interrupt();
             }
             else
             {
-               earliest = std::min(earliest, remaining);
-               *iter++  = child;
+               earliest = std::min(earliest.value_or(remaining), remaining);
             }
          }
-         children.erase(iter, children.end());
-         cond.wait_for(l, earliest);
+         slot->scanning.store(false);
+      }
+      return earliest;
+   }
+
+   void WatchdogManager::run()
+   {
+      // The number of ticks to keep polling after the last watchdog was
+      // disarmed. Transactions usually follow each other closely.
+      constexpr int idleTicks = 100;
+
+      std::unique_lock l{mutex};
+      int              idleCount = 0;
+      while (!done)
+      {
+         // The scan may miss a watchdog that is armed while it runs. Such a
+         // watchdog sees scanning and wakes the manager.
+         wakeAt.store(scanning);
+         woken         = false;
+         auto earliest = scan();
+         if (earliest)
+            idleCount = 0;
+         if (earliest || ++idleCount < idleTicks)
+         {
+            auto wait  = std::min<CpuClock::duration>(earliest.value_or(tick), tick);
+            auto until = WakeClock::now() + std::chrono::duration_cast<WakeClock::duration>(wait);
+            wakeAt.store(until.time_since_epoch().count());
+            cond.wait_until(l, until, [&] { return done || woken; });
+         }
+         else
+         {
+            wakeAt.store(idle);
+            cond.wait(l, [&] { return done || woken; });
+            idleCount = 0;
+         }
       }
    }
 
    Watchdog::Watchdog(WatchdogManager& m, std::function<void()> handler)
        : manager(&m),
+         slot(m.getSlot()),
          paused(false),
          elapsedOrStart(CpuClock::now().time_since_epoch()),
          handler(handler)
    {
-      if (int err = pthread_getcpuclockid(pthread_self(), &cpuclock))
+      next.store(slot->head.load());
+      slot->head.store(this);
+   }
+   Watchdog::~Watchdog()
+   {
+      auto* pos = &slot->head;
+      while (pos->load() != this)
+         pos = &pos->load()->next;
+      pos->store(next.load());
+      // The manager may still be looking at this watchdog
+      while (slot->scanning.load())
       {
-         throw std::system_error(err, std::system_category());
       }
-      manager->add(this);
    }
-   Watchdog::~Watchdog()
+   void Watchdog::arm()
    {
-      manager->remove(this);
+      auto result = CpuClock::duration::max();
+      if (!paused && limit < CpuClock::duration::max() - elapsedOrStart)
+         result = elapsedOrStart + limit;
+      deadline.store(result.count());
+      if (result != CpuClock::duration::max())
+         manager->wake(result - CpuClock::now().time_since_epoch());
    }
    void Watchdog::setLimit(CpuClock::duration dur)
    {
       assert(dur.count() >= 0);
-      bool notify = dur < limit;
-      {
-         std::lock_guard l{manager->mutex};
-         limit = dur;
-      }
-      if (notify)
-      {
-         manager->cond.notify_one();
-      }
+      limit = dur;
+      arm();
    }
    void Watchdog::pause()
    {
       assert(!paused);
-      std::lock_guard l{manager->mutex};
       paused         = true;
       elapsedOrStart = CpuClock::now().time_since_epoch() - elapsedOrStart;
+      arm();
    }
    void Watchdog::resume()
    {
       assert(paused);
-      {
-         std::lock_guard l{manager->mutex};
-         paused         = false;
-         elapsedOrStart = CpuClock::now().time_since_epoch() - elapsedOrStart;
-      }
-      manager->cond.notify_one();
+      paused         = false;
+      elapsedOrStart = CpuClock::now().time_since_epoch() - elapsedOrStart;
+      arm();
    }
    CpuClock::duration Watchdog::elapsed()
    {
@@ -126,16 +232,5 @@ namespace psibase
    {
       handler();
    }
-   CpuClock::duration Watchdog::wait_duration()
-   {
-      if (paused)
-      {
-         return CpuClock::duration::max();
-      }
-      else
-      {
-         return limit - (CpuClock::now(cpuclock).time_since_epoch() - elapsedOrStart);
-      }
-   }
 
 }  // namespace psibase
@@ -3,6 +3,12 @@
 #include <boost/filesystem/operations.hpp>
 #include <triedent/database.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 // #define SANITY_CHECK
 
 #ifdef SANITY_CHECK
@@ -27,11 +33,88 @@ namespace psibase
       return result;
    }
 
-   // TODO: move triedent::root destruction to a gc thread
+   // Drops roots on a dedicated thread. Dropping the last reference to a
+   // tree walks and frees every node that no other tree shares, which takes
+   // a long time after a long fork is pruned. The queue is bounded; while it
+   // is full, push releases the root on the calling thread, so a backlog
+   // slows the caller down instead of growing without limit.
+   struct RootReleaser
+   {
+      static constexpr std::size_t maxPending = 4096;
+
+      std::mutex                                  mutex;
+      std::condition_variable                     notEmpty;
+      std::deque<std::shared_ptr<triedent::root>> pending;
+      bool                                        done = false;
+      std::thread                                 thread;
+
+      RootReleaser()
+      {
+         thread = std::thread{[this]
+                              {
+                                 pthread_setname_np(pthread_self(), "db-release");
+                                 run();
+                              }};
+      }
+
+      ~RootReleaser()
+      {
+         {
+            std::lock_guard lock{mutex};
+            done = true;
+         }
+         notEmpty.notify_one();
+         thread.join();
+      }
+
+      void push(std::shared_ptr<triedent::root> root)
+      {
+         if (!root)
+            return;
+         {
+            std::lock_guard lock{mutex};
+            if (pending.size() < maxPending)
+            {
+               pending.push_back(std::move(root));
+               notEmpty.notify_one();
+               return;
+            }
+         }
+         root.reset();
+      }
+
+      std::size_t size()
+      {
+         std::lock_guard lock{mutex};
+         return pending.size();
+      }
+
+      // Exits once done is set and the queue is empty
+      void run()
+      {
+         std::unique_lock lock{mutex};
+         while (true)
+         {
+            notEmpty.wait(lock, [&] { return done || !pending.empty(); });
+            if (pending.empty())
+               return;
+            auto root = std::move(pending.front());
+            pending.pop_front();
+            lock.unlock();
+            root.reset();
+            lock.lock();
+         }
+      }
+   };
+
    struct Revision
    {
       std::shared_ptr<triedent::root> roots[numDatabases];
 
+      // If set, roots are released by this instead of by the thread that
+      // drops the revision
+      std::shared_ptr<RootReleaser> releaser;
+
 #ifdef SANITY_CHECK
       std::map<std::vector<char>, std::vector<char>, blob_less> _sanity[numDatabases];
 
@@ -49,12 +132,20 @@ namespace psibase
       Revision& operator=(const Revision&) = delete;
       Revision& operator=(Revision&&)      = default;
 
+      ~Revision()
+      {
+         if (releaser)
+            for (auto& root : roots)
+               releaser->push(std::move(root));
+      }
+
       std::shared_ptr<Revision> clone() const
       {
          std::shared_ptr<Revision> result = std::make_shared<Revision>();
 
          for (uint32_t i = 0; i < numDatabases; ++i)
             result->roots[i] = roots[i];
+         result->releaser = releaser;
 
 #ifdef SANITY_CHECK
          for (uint32_t i = 0; i < numDatabases; ++i)
@@ -139,9 +230,11 @@ namespace psibase
    static std::shared_ptr<Revision> loadRevision(triedent::write_session&               s,
                                                  const std::shared_ptr<triedent::root>& topRoot,
                                                  std::span<const char>                  key,
+                                                 const std::shared_ptr<RootReleaser>&   releaser,
                                                  bool nullIfNotFound = false)
    {
-      auto                                         revision = std::make_shared<Revision>();
+      auto revision      = std::make_shared<Revision>();
+      revision->releaser = releaser;
       std::vector<std::shared_ptr<triedent::root>> roots;
       if (s.get(topRoot, key, nullptr, &roots))
       {
@@ -173,15 +266,46 @@ namespace psibase
    struct SharedDatabaseImpl
    {
       std::shared_ptr<triedent::database> trie;
+      std::shared_ptr<RootReleaser>       releaser = std::make_shared<RootReleaser>();
+      DbPolicy                            policies[numDatabases];
 
       std::mutex                      headMutex;
       std::shared_ptr<const Revision> head;
+      // Incremented whenever head changes
+      std::atomic<std::uint64_t> headVersion{1};
+
+      // Each slot may hold an idle read session and a copy of head. Queries
+      // take both from a slot instead of creating a session or locking
+      // headMutex. A slot is claimed with a flag; a thread that finds it
+      // busy moves on to another slot or to the slow path and never waits.
+      struct alignas(64) PoolSlot
+      {
+         std::atomic_flag                        busy = ATOMIC_FLAG_INIT;
+         std::shared_ptr<triedent::read_session> reader;
+         std::uint64_t                           headVersion = 0;
+         std::shared_ptr<const Revision>         head;
+
+         bool tryLock() { return !busy.test_and_set(std::memory_order_acquire); }
+         void unlock() { busy.clear(std::memory_order_release); }
+      };
+      static constexpr std::size_t poolSize = 64;
+      PoolSlot                     pool[poolSize];
+
+      // Spreads threads over the slots, so that each thread usually finds
+      // its own slot free
+      static std::size_t threadSlot()
+      {
+         static std::atomic<std::size_t> nextThread{0};
+         thread_local std::size_t        slot = nextThread.fetch_add(1) % poolSize;
+         return slot;
+      }
 
       SharedDatabaseImpl(const std::filesystem::path& dir,
                          uint64_t                     hot_bytes,
                          uint64_t                     warm_bytes,
                          uint64_t                     cool_bytes,
-                         uint64_t                     cold_bytes)
+                         uint64_t                     cold_bytes,
+                         bool                         perLevelSwap)
       {
          // The largest object is 16 MiB
          // Each file must be at least double this
@@ -207,15 +331,40 @@ namespace psibase
          {
             // std::cout << "Open existing " << dir << "\n";
          }
-         trie   = std::make_shared<triedent::database>(dir.c_str(), triedent::database::read_write);
+         auto swap = perLevelSwap ? triedent::swap_mode::per_level : triedent::swap_mode::single;
+         trie      = std::make_shared<triedent::database>(
+             dir.c_str(), triedent::database::config{.swap = swap}, triedent::database::read_write);
          auto s = trie->start_write_session();
-         head   = loadRevision(*s, s->get_top_root(), revisionHeadKey);
+         head   = loadRevision(*s, s->get_top_root(), revisionHeadKey, releaser);
       }
 
-      auto getHead()
+      std::shared_ptr<const Revision> getHead()
       {
-         std::lock_guard<std::mutex> lock(headMutex);
-         return head;
+         auto& slot    = pool[threadSlot()];
+         auto  version = headVersion.load(std::memory_order_acquire);
+         if (slot.tryLock())
+         {
+            std::shared_ptr<const Revision> result;
+            if (slot.headVersion == version)
+               result = slot.head;
+            slot.unlock();
+            if (result)
+               return result;
+         }
+
+         std::shared_ptr<const Revision> result;
+         {
+            std::lock_guard<std::mutex> lock(headMutex);
+            result  = head;
+            version = headVersion.load(std::memory_order_relaxed);
+         }
+         if (slot.tryLock())
+         {
+            slot.head        = result;
+            slot.headVersion = version;
+            slot.unlock();
+         }
+         return result;
       }
 
       void setHead(triedent::write_session& session, std::shared_ptr<const Revision> r)
@@ -224,8 +373,59 @@ namespace psibase
          session.upsert(topRoot, revisionHeadKey, r->roots);
          session.set_top_root(topRoot);
 
-         std::lock_guard<std::mutex> lock(headMutex);
-         head = std::move(r);
+         {
+            std::lock_guard<std::mutex> lock(headMutex);
+            head = std::move(r);
+            headVersion.fetch_add(1, std::memory_order_release);
+         }
+
+         // Stale copies would keep old revisions alive until the next
+         // query on each thread
+         for (auto& slot : pool)
+         {
+            std::shared_ptr<const Revision> stale;
+            if (slot.tryLock())
+            {
+               stale = std::move(slot.head);
+               slot.unlock();
+            }
+         }
+      }
+
+      std::shared_ptr<triedent::read_session> checkoutReader()
+      {
+         auto start = threadSlot();
+         for (std::size_t i = 0; i < poolSize; ++i)
+         {
+            auto& slot = pool[(start + i) % poolSize];
+            if (slot.tryLock())
+            {
+               auto result = std::move(slot.reader);
+               slot.unlock();
+               if (result)
+                  return result;
+            }
+         }
+         return trie->start_read_session();
+      }
+
+      void returnReader(std::shared_ptr<triedent::read_session> reader)
+      {
+         auto start = threadSlot();
+         for (std::size_t i = 0; i < poolSize; ++i)
+         {
+            auto& slot = pool[(start + i) % poolSize];
+            if (slot.tryLock())
+            {
+               bool empty = !slot.reader;
+               if (empty)
+                  slot.reader = std::move(reader);
+               slot.unlock();
+               if (empty)
+                  return;
+            }
+         }
+         // The pool is full. Destroying the session unregisters it.
       }
 
       void writeRevision(triedent::write_session& session,
@@ -242,12 +442,14 @@ namespace psibase
                                   uint64_t                       hot_bytes,
                                   uint64_t                       warm_bytes,
                                   uint64_t                       cool_bytes,
-                                  uint64_t                       cold_bytes)
+                                  uint64_t                       cold_bytes,
+                                  bool                           perLevelSwap)
        : impl{std::make_shared<SharedDatabaseImpl>(dir.c_str(),
                                                    hot_bytes,
                                                    warm_bytes,
                                                    cool_bytes,
-                                                   cold_bytes)}
+                                                   cold_bytes,
+                                                   perLevelSwap)}
    {
    }
 
@@ -258,7 +460,9 @@ namespace psibase
 
    ConstRevisionPtr SharedDatabase::emptyRevision()
    {
-      return std::make_shared<Revision>();
+      auto result      = std::make_shared<Revision>();
+      result->releaser = impl->releaser;
+      return result;
    }
 
    WriterPtr SharedDatabase::createWriter()
@@ -273,15 +477,20 @@ namespace psibase
 
    ConstRevisionPtr SharedDatabase::getRevision(Writer& writer, const Checksum256& blockId)
    {
-      return loadRevision(writer, writer.get_top_root(), revisionById(blockId), true);
+      return loadRevision(writer, writer.get_top_root(), revisionById(blockId), impl->releaser,
+                          true);
    }
 
-   // TODO: move triedent::root destruction to a gc thread
    void SharedDatabase::removeRevisions(Writer& writer, const Checksum256& irreversible)
    {
       auto              topRoot = writer.get_top_root();
       std::vector<char> key{revisionByIdPrefix};
 
+      // Holding the original top root keeps the removed revisions alive,
+      // so the removals below only copy the top of the tree. The removed
+      // revisions are freed when the releaser drops oldTop.
+      auto oldTop = topRoot;
+
       // Remove everything with a blockNum <= irreversible's, except irreversible.
       while (writer.get_greater_equal(topRoot, key, &key, nullptr, nullptr))
       {
@@ -314,6 +523,8 @@ namespace psibase
       }
 
       writer.set_top_root(topRoot);
+      roots.clear();
+      impl->releaser->push(std::move(oldTop));
    }  // removeRevisions
 
    void SharedDatabase::setBlockData(Writer&               writer,
@@ -344,17 +555,65 @@ namespace psibase
       return reader.get(topRoot, fullKey);
    }
 
+   void SharedDatabase::setPolicy(DbId db, const DbPolicy& policy)
+   {
+      check((uint32_t)db < numDatabases, "setPolicy: invalid database");
+      impl->policies[(int)db] = policy;
+   }
+
    bool SharedDatabase::isSlow() const
    {
       return impl->trie->is_slow();
    }
 
+   std::size_t SharedDatabase::pendingReleases() const
+   {
+      return impl->releaser->size();
+   }
+
    std::vector<std::span<const char>> SharedDatabase::span() const
    {
       auto result = impl->trie->span();
       return {result.begin(), result.end()};
    }
 
+   // Applies a DbPolicy to a session until the end of the scope. The writer
+   // is shared with SharedDatabase, which keeps its own data in hot, so its
+   // previous settings are restored afterwards.
+   struct PolicyScope
+   {
+      triedent::write_session* writer = nullptr;
+      bool                     oldPromote;
+      triedent::placement      oldPlacement;
+
+      PolicyScope(triedent::read_session* reader,
+                  triedent::write_session* writer,
+                  const DbPolicy&          policy,
+                  bool                     promote)
+      {
+         if (reader)
+            reader->set_promote(promote && policy.promote);
+         else if (writer)
+         {
+            this->writer = writer;
+            oldPromote   = writer->promote();
+            oldPlacement = writer->get_placement();
+            writer->set_promote(oldPromote && policy.promote);
+            writer->set_placement(policy.coldWrites ? triedent::placement::cold
+                                                    : triedent::placement::hot);
+         }
+      }
+      PolicyScope(const PolicyScope&) = delete;
+      ~PolicyScope()
+      {
+         if (writer)
+         {
+            writer->set_promote(oldPromote);
+            writer->set_placement(oldPlacement);
+         }
+      }
+   };
+
    struct DatabaseImpl
    {
       SharedDatabase                           shared;
@@ -365,6 +624,12 @@ namespace psibase
       std::shared_ptr<const Revision>          readOnlyRevision;
       std::vector<char>                        keyBuffer;
       std::vector<char>                        valueBuffer;
+      bool                                     promote   = true;
+      AccessLog*                               accessLog = nullptr;
+
+      // Writes to writeRevisions.back() which haven't been applied to its
+      // roots yet. They are applied in one pass by flush().
+      triedent::write_batch pendingWrites[numDatabases];
 
       template <typename F>
       auto read(F f)
@@ -392,7 +657,29 @@ namespace psibase
          return f(*writeSession, *writeRevisions.back());
       }
 
-      // TODO: release old revision roots in GC thread
+      // Applies db's policy to whichever session read and write will use
+      PolicyScope usePolicy(DbId db)
+      {
+         return {readSession.get(), writeSession.get(), shared.impl->policies[(int)db], promote};
+      }
+
+      void flush(DbId db)
+      {
+         auto& pending = pendingWrites[(int)db];
+         if (pending.empty())
+            return;
+         auto scope = usePolicy(db);
+         write([&](auto& session, auto& revision)
+               { session.apply(revision.roots[(int)db], pending); });
+         pending.clear();
+      }
+
+      void flushAll()
+      {
+         for (uint32_t i = 0; i < numDatabases; ++i)
+            flush((DbId)i);
+      }
+
       void setRevision(ConstRevisionPtr revision)
       {
          check(writeRevisions.empty() && !readOnlyRevision,
@@ -401,12 +688,13 @@ namespace psibase
          baseRevision = std::move(revision);
       }
 
-      void startRead()
+      void startRead(bool promote)
       {
          check(writeRevisions.empty() && !readOnlyRevision,
                "startRead: database session already active");
          if (!readSession && !writeSession)
-            readSession = shared.impl->trie->start_read_session();
+            readSession = shared.impl->checkoutReader();
+         this->promote    = promote;
          readOnlyRevision = baseRevision;
       }
 
@@ -414,14 +702,24 @@ namespace psibase
       {
          check(!readOnlyRevision, "startWrite: can't mix read and write revisions");
          check(writer != nullptr, "startWrite: writer is null");
+         flushAll();
          writeSession = std::move(writer);
-         readSession  = nullptr;
+         returnReader();
          if (writeRevisions.empty())
             writeRevisions.push_back(baseRevision->clone());
          else
             writeRevisions.push_back(writeRevisions.back()->clone());
       }
 
+      // Iterators keep their own reference to the session, and a session
+      // that is still referenced can't be handed to another thread
+      void returnReader()
+      {
+         if (readSession.use_count() == 1)
+            shared.impl->returnReader(std::move(readSession));
+         readSession = nullptr;
+      }
+
       void commit()
       {
          if (readOnlyRevision)
@@ -438,6 +736,7 @@ namespace psibase
       {
          check((bool)writeSession, "writeSession is missing");
          check(writeRevisions.size() == 1, "not final commit");
+         flushAll();
          auto rev = writeRevisions.back();
          shared.impl->writeRevision(*writeSession, blockId, *rev);
          baseRevision = std::move(rev);
@@ -450,7 +749,11 @@ namespace psibase
          if (readOnlyRevision)
             readOnlyRevision = nullptr;
          else if (!writeRevisions.empty())
+         {
+            for (auto& pending : pendingWrites)
+               pending.clear();
             writeRevisions.pop_back();
+         }
       }
    };  // DatabaseImpl
 
@@ -461,7 +764,10 @@ namespace psibase
       impl = std::make_unique<DatabaseImpl>(DatabaseImpl{std::move(shared), std::move(revision)});
    }
 
-   Database::~Database() {}
+   Database::~Database()
+   {
+      impl->returnReader();
+   }
 
    void Database::setRevision(ConstRevisionPtr revision)
    {
@@ -476,14 +782,17 @@ namespace psibase
    ConstRevisionPtr Database::getModifiedRevision()
    {
       if (!impl->writeRevisions.empty())
+      {
+         impl->flushAll();
          return impl->writeRevisions.back();
+      }
       else
          return impl->baseRevision;
    }
 
-   Database::Session Database::startRead()
+   Database::Session Database::startRead(bool promote)
    {
-      impl->startRead();
+      impl->startRead(promote);
       return {this};
    }
 
@@ -508,8 +817,23 @@ namespace psibase
       impl->abort();
    }
 
+   void Database::setAccessLog(AccessLog* log)
+   {
+      impl->accessLog = log;
+   }
+
    void Database::kvPutRaw(DbId db, psio::input_stream key, psio::input_stream value)
    {
+      if (impl->accessLog)
+         impl->accessLog->writes.push_back({db, key.vector(), value.vector()});
+      if constexpr (!sanityCheck)
+      {
+         check(impl->writeSession && !impl->writeRevisions.empty(),
+               "no database write sessions active");
+         impl->pendingWrites[(int)db].upsert(key.string_view(), value.string_view());
+         return;
+      }
+      auto scope = impl->usePolicy(db);
       impl->write(
           [&](auto& session, auto& revision)
           {
@@ -524,6 +848,16 @@ namespace psibase
 
    void Database::kvRemoveRaw(DbId db, psio::input_stream key)
    {
+      if (impl->accessLog)
+         impl->accessLog->writes.push_back({db, key.vector(), std::nullopt});
+      if constexpr (!sanityCheck)
+      {
+         check(impl->writeSession && !impl->writeRevisions.empty(),
+               "no database write sessions active");
+         impl->pendingWrites[(int)db].remove(key.string_view());
+         return;
+      }
+      auto scope = impl->usePolicy(db);
       impl->write(
           [&](auto& session, auto& revision)
           {
@@ -538,6 +872,16 @@ namespace psibase
 
    std::optional<psio::input_stream> Database::kvGetRaw(DbId db, psio::input_stream key)
    {
+      if (impl->accessLog)
+         impl->accessLog->reads.emplace_back(db, key.vector());
+      if (auto pending = impl->pendingWrites[(int)db].find(key.string_view()))
+      {
+         if (!*pending)
+            return {};
+         impl->valueBuffer.assign((*pending)->begin(), (*pending)->end());
+         return {{impl->valueBuffer}};
+      }
+      auto scope = impl->usePolicy(db);
       return impl->read(
           [&](auto& session, auto& revision) -> std::optional<psio::input_stream>
           {
@@ -565,10 +909,46 @@ namespace psibase
           });
    }  // Database::kvGetRaw
 
+   bool Database::kvGetRaw(DbId db, psio::input_stream key, std::vector<char>& value)
+   {
+      if constexpr (sanityCheck)
+      {
+         auto result = kvGetRaw(db, key);
+         if (result)
+            value.assign(result->pos, result->end);
+         return result.has_value();
+      }
+      if (impl->accessLog)
+         impl->accessLog->reads.emplace_back(db, key.vector());
+      if (auto pending = impl->pendingWrites[(int)db].find(key.string_view()))
+      {
+         if (!*pending)
+            return false;
+         value.assign((*pending)->begin(), (*pending)->end());
+         return true;
+      }
+      auto scope = impl->usePolicy(db);
+      return impl->read(
+          [&](auto& session, auto& revision)
+          {
+             auto l    = session.lock_cache();
+             auto view = session.get_view(l, revision.roots[(int)db], key.string_view());
+             if (!view)
+                return false;
+             value.assign(view->begin(), view->end());
+             return true;
+          });
+   }  // Database::kvGetRaw
+
    std::optional<Database::KVResult> Database::kvGreaterEqualRaw(DbId               db,
                                                                  psio::input_stream key,
                                                                  size_t             matchKeySize)
    {
+      if (impl->accessLog)
+         impl->accessLog->prefixReads.emplace_back(
+             db, std::vector<char>(key.pos, key.pos + std::min(matchKeySize, key.remaining())));
+      impl->flush(db);
+      auto scope = impl->usePolicy(db);
       return impl->read(
           [&](auto& session, auto& revision) -> std::optional<Database::KVResult>
           {
@@ -615,6 +995,11 @@ namespace psibase
                                                              psio::input_stream key,
                                                              size_t             matchKeySize)
    {
+      if (impl->accessLog)
+         impl->accessLog->prefixReads.emplace_back(
+             db, std::vector<char>(key.pos, key.pos + std::min(matchKeySize, key.remaining())));
+      impl->flush(db);
+      auto scope = impl->usePolicy(db);
       return impl->read(
           [&](auto& session, auto& revision) -> std::optional<Database::KVResult>
           {
@@ -672,6 +1057,10 @@ namespace psibase
 
    std::optional<Database::KVResult> Database::kvMaxRaw(DbId db, psio::input_stream key)
    {
+      if (impl->accessLog)
+         impl->accessLog->prefixReads.emplace_back(db, key.vector());
+      impl->flush(db);
+      auto scope = impl->usePolicy(db);
       return impl->read(
           [&](auto& session, auto& revision) -> std::optional<Database::KVResult>
           {
@@ -701,4 +1090,87 @@ namespace psibase
           });
    }  // Database::kvMaxRaw
 
+   struct Database::KVIterator
+   {
+      std::shared_ptr<triedent::read_session> session;
+      triedent::read_session::cursor          cursor;
+      std::vector<char>                       prefix;
+      DbId                                    db;
+
+      // The gap is before the cursor's key, or after it if consumed is set
+      bool consumed = false;
+   };
+
+   std::shared_ptr<Database::KVIterator> Database::kvIterOpenRaw(DbId               db,
+                                                                 psio::input_stream key,
+                                                                 size_t             matchKeySize)
+   {
+      if (impl->accessLog)
+         impl->accessLog->prefixReads.emplace_back(
+             db, std::vector<char>(key.pos, key.pos + std::min(matchKeySize, key.remaining())));
+      impl->flush(db);
+      std::shared_ptr<triedent::read_session> session = impl->readSession;
+      if (!session)
+         session = impl->writeSession;
+      auto scope = impl->usePolicy(db);
+      return impl->read(
+          [&](auto&, auto& revision)
+          {
+             auto result = std::make_shared<KVIterator>(KVIterator{
+                 session,
+                 {*session, revision.roots[(int)db]},
+                 {key.pos, key.pos + matchKeySize},
+                 db,
+             });
+             result->cursor.lower_bound(key.string_view());
+             return result;
+          });
+   }
+
+   namespace
+   {
+      std::optional<Database::KVResult> iterResult(DatabaseImpl& impl, Database::KVIterator& it)
+      {
+         it.cursor.get_key(impl.keyBuffer);
+         if (impl.keyBuffer.size() < it.prefix.size() ||
+             memcmp(impl.keyBuffer.data(), it.prefix.data(), it.prefix.size()))
+            return {};
+         it.cursor.get_value(&impl.valueBuffer, nullptr);
+         return Database::KVResult{impl.keyBuffer, impl.valueBuffer};
+      }
+   }  // namespace
+
+   std::optional<Database::KVResult> Database::kvIterNextRaw(KVIterator& it)
+   {
+      auto scope = impl->usePolicy(it.db);
+      if (it.consumed)
+      {
+         it.consumed = false;
+         if (!it.cursor.next())
+            return {};
+      }
+      else if (!it.cursor.valid())
+         return {};
+      auto result = iterResult(*impl, it);
+      it.consumed = result.has_value();
+      return result;
+   }  // Database::kvIterNextRaw
+
+   std::optional<Database::KVResult> Database::kvIterPrevRaw(KVIterator& it)
+   {
+      auto scope = impl->usePolicy(it.db);
+      if (!it.consumed)
+      {
+         if (!it.cursor.prev())
+         {
+            // Already before the first key; the cursor wrapped around
+            it.cursor.next();
+            return {};
+         }
+      }
+      auto result = iterResult(*impl, it);
+      it.consumed = !result.has_value();
+      return result;
+   }  // Database::kvIterPrevRaw
+
 }  // namespace psibase
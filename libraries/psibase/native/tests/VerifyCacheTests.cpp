@@ -0,0 +1,74 @@
+#include <psibase/VerifyCache.hpp>
+
+#include <string_view>
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+using namespace psibase;
+
+namespace
+{
+   // VerifyCache only compares the addresses of revisions and checks
+   // whether they are still alive, so any object can stand in for one.
+   ConstRevisionPtr makeRevision()
+   {
+      auto owner = std::make_shared<char>();
+      return {owner, reinterpret_cast<const Revision*>(owner.get())};
+   }
+
+   VerifyCache::Key makeKey(const ConstRevisionPtr& revision,
+                            std::string_view        data,
+                            std::string_view        signature = "sig",
+                            AccountNumber           service   = AccountNumber{"verify-sys"})
+   {
+      return VerifyCache::makeKey(revision, data, Claim{service, {'k', 'e', 'y'}},
+                                  std::span{signature.data(), signature.size()});
+   }
+}  // namespace
+
+TEST_CASE("VerifyCache keys depend on all of their inputs")
+{
+   auto revision = makeRevision();
+   auto key      = makeKey(revision, "data");
+   CHECK(key == makeKey(revision, "data"));
+   CHECK(key != makeKey(revision, "other data"));
+   CHECK(key != makeKey(revision, "data", "other sig"));
+   CHECK(key != makeKey(revision, "data", "sig", AccountNumber{"other-sys"}));
+   CHECK(key != makeKey(makeRevision(), "data"));
+}
+
+TEST_CASE("VerifyCache forgets entries when their revision is freed")
+{
+   VerifyCache cache;
+   auto        revision = makeRevision();
+   auto        key      = makeKey(revision, "data");
+   CHECK(!cache.contains(key));
+   cache.insert(key, revision);
+   CHECK(cache.contains(key));
+   revision.reset();
+   CHECK(!cache.contains(key));
+}
+
+TEST_CASE("VerifyCache drops the oldest entry when it is full")
+{
+   VerifyCache cache{2};
+   auto        revision = makeRevision();
+   auto        k1       = makeKey(revision, "1");
+   auto        k2       = makeKey(revision, "2");
+   auto        k3       = makeKey(revision, "3");
+   auto        k4       = makeKey(revision, "4");
+   cache.insert(k1, revision);
+   cache.insert(k2, revision);
+   cache.insert(k3, revision);
+   CHECK(!cache.contains(k1));
+   CHECK(cache.contains(k2));
+   CHECK(cache.contains(k3));
+
+   // Inserting an entry again does not make it newer
+   cache.insert(k2, revision);
+   cache.insert(k4, revision);
+   CHECK(!cache.contains(k2));
+   CHECK(cache.contains(k3));
+   CHECK(cache.contains(k4));
+}
@@ -0,0 +1,75 @@
+#include <psibase/Watchdog.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Measures the cost of creating watchdogs and of arming and disarming them
+// when many threads use the same WatchdogManager at once. Times are thread
+// CPU time, so they are comparable on machines with fewer cores than threads.
+
+using namespace psibase;
+
+struct Result
+{
+   double createNs;
+   double armNs;
+};
+
+Result run(WatchdogManager& manager, int numThreads, int iterations)
+{
+   std::vector<std::chrono::nanoseconds> createTimes(numThreads);
+   std::vector<std::chrono::nanoseconds> armTimes(numThreads);
+   std::vector<std::jthread>             threads;
+   for (int t = 0; t < numThreads; ++t)
+   {
+      threads.emplace_back(
+          [&, t]
+          {
+             auto start = CpuClock::now();
+             for (int i = 0; i < iterations; ++i)
+             {
+                Watchdog watchdog(manager, [] {});
+                watchdog.setLimit(std::chrono::seconds(10));
+             }
+             createTimes[t] = CpuClock::now() - start;
+
+             Watchdog watchdog(manager, [] {});
+             watchdog.setLimit(std::chrono::seconds(10));
+             start = CpuClock::now();
+             for (int i = 0; i < iterations; ++i)
+             {
+                watchdog.pause();
+                watchdog.resume();
+             }
+             armTimes[t] = CpuClock::now() - start;
+          });
+   }
+   threads.clear();
+
+   Result result{};
+   for (int t = 0; t < numThreads; ++t)
+   {
+      result.createNs += double(createTimes[t].count()) / iterations;
+      result.armNs += double(armTimes[t].count()) / (2 * iterations);
+   }
+   result.createNs /= numThreads;
+   result.armNs /= numThreads;
+   return result;
+}
+
+int main(int argc, char** argv)
+{
+   int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+   WatchdogManager manager;
+   std::cout << "threads    create (ns)    arm/disarm (ns)\n";
+   for (int numThreads : {1, 8, 64})
+   {
+      auto result = run(manager, numThreads, iterations);
+      std::cout << std::setw(7) << numThreads << std::fixed << std::setprecision(1)
+                << std::setw(15) << result.createNs << std::setw(19) << result.armNs << "\n";
+   }
+}
@@ -122,3 +122,43 @@ TEST_CASE("Watchdog threaded")
       CHECK(durations[i] - std::chrono::milliseconds(i * 10) < std::chrono::milliseconds(5));
    }
 }
+
+TEST_CASE("Watchdog nested")
+{
+   std::atomic<bool> outerInterrupted{false};
+   std::atomic<bool> innerInterrupted{false};
+   WatchdogManager   manager;
+   Watchdog          outer(manager, [&] { outerInterrupted = true; });
+   outer.setLimit(std::chrono::milliseconds(10));
+   {
+      Watchdog inner(manager, [&] { innerInterrupted = true; });
+      inner.setLimit(std::chrono::milliseconds(1));
+      while (!innerInterrupted)
+      {
+      }
+      CHECK(!outerInterrupted.load());
+   }
+   while (!outerInterrupted)
+   {
+   }
+   CHECK(outerInterrupted.load());
+}
+
+TEST_CASE("Watchdog pause")
+{
+   std::atomic<bool> interrupted{false};
+   WatchdogManager   manager;
+   Watchdog          watchdog(manager, [&] { interrupted = true; });
+   watchdog.setLimit(std::chrono::milliseconds(1));
+   watchdog.pause();
+   auto start = CpuClock::now();
+   while (CpuClock::now() - start < std::chrono::milliseconds(5))
+   {
+   }
+   CHECK(!interrupted.load());
+   watchdog.resume();
+   while (!interrupted)
+   {
+   }
+   CHECK(watchdog.elapsed() >= std::chrono::milliseconds(1));
+}
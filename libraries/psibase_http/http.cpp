@@ -702,9 +702,9 @@ namespace psibase::http
             l.unlock();
 
             // TODO: time limit
-            auto          system = server.sharedState->getSystemContext();
+            auto          system = server.sharedState->getSystemContext(SystemContextPool::rpc);
             psio::finally f{[&]() { server.sharedState->addSystemContext(std::move(system)); }};
-            BlockContext  bc{*system, system->sharedDatabase.getHead()};
+            BlockContext  bc{*system, system->sharedDatabase.getHead(), false};
             bc.start();
             if (bc.needGenesisAction)
                return send(error(bhttp::status::internal_server_error,
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <triedent/frequency_sketch.hpp>
 #include <triedent/gc_queue.hpp>
 #include <triedent/object_db.hpp>
 #include <triedent/region_allocator.hpp>
@@ -9,11 +10,46 @@
 #include <atomic>
 #include <filesystem>
 #include <span>
+#include <thread>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace triedent
 {
+   // Decides which objects get_cache<true> copies from a colder level
+   // into hot.
+   enum class hot_admission : std::uint8_t
+   {
+      // Every object that is read is promoted
+      always,
+      // Only objects that have been read at least admission_threshold times
+      // recently are promoted. This keeps a single scan over a large range
+      // from evicting the working set.
+      frequency,
+   };
+
+   // Decides where alloc puts new objects
+   enum class placement : std::uint8_t
+   {
+      // New objects start in hot and age out through warm and cool
+      hot,
+      // New objects are written directly to cold. This is for data that is
+      // written once and rarely read, which would otherwise push the
+      // working set out of hot.
+      cold,
+   };
+
+   // Decides which threads move objects to colder levels
+   enum class swap_mode : std::uint8_t
+   {
+      // One thread moves hot->warm, warm->cool and cool->cold in turn
+      single,
+      // Each source level gets its own thread, so a full warm or cool
+      // level doesn't hold up hot
+      per_level,
+   };
+
    // Cache allocator manages all storage for the database.
    //
    // It maintains multiple buffers and moves accessed data to the hot
@@ -39,6 +75,11 @@ namespace triedent
          uint64_t warm_bytes = 1000 * 1000ull;
          uint64_t cool_bytes = 1000 * 1000ull;
          uint64_t cold_bytes = 1000 * 1000ull;
+
+         swap_mode swap = swap_mode::single;
+
+         hot_admission admission           = hot_admission::frequency;
+         uint32_t      admission_threshold = 2;
       };
 
       cache_allocator(const std::filesystem::path& path,
@@ -60,14 +101,18 @@ namespace triedent
       // not be called by the swap thread.
       std::pair<location_lock, void*> alloc(std::unique_lock<gc_queue::session>& session,
                                             std::size_t                          num_bytes,
-                                            node_type                            type);
+                                            node_type                            type,
+                                            placement where = placement::hot);
 
       std::pair<void*, node_type> release(session_lock_ref<>, id i);
 
       // The returned pointer will remain valid until the session lock is released
-      // get_cache is non-blocking.
+      // get_cache is non-blocking. With admit_all, CopyToHot promotes the
+      // object regardless of the admission policy.
       template <bool CopyToHot>
-      std::tuple<void*, node_type, std::uint16_t> get_cache(session_lock_ref<> session, id i);
+      std::tuple<void*, node_type, std::uint16_t> get_cache(session_lock_ref<> session,
+                                                            id                 i,
+                                                            bool               admit_all = false);
 
       std::uint16_t ref(id i) { return _obj_ids.ref(i); }
 
@@ -92,14 +137,40 @@ namespace triedent
       void print_stats(std::ostream& os, bool detail);
 
      private:
-      bool  swap(gc_session&);
-      void* try_move_object(session_lock_ref<>   session,
+      // Decides whether an object read from a colder level should be copied to hot
+      bool admit(object_id id)
+      {
+         return _admission == hot_admission::always ||
+                _sketch.increment(id.id) >= _admission_threshold;
+      }
+
+      // Read counters are spread over several cache lines, because
+      // every read updates them.
+      struct alignas(64) read_stats
+      {
+         std::atomic<std::uint64_t> hot_reads{0};
+         std::atomic<std::uint64_t> cold_reads{0};
+         std::atomic<std::uint64_t> promoted{0};
+      };
+      static constexpr std::size_t num_read_stats = 16;
+      read_stats&                  local_read_stats();
+
+      struct swap_result
+      {
+         bool          did_work = false;
+         std::uint32_t blocked  = 0;  // size of an object that did not fit, if any
+      };
+
+      bool        swap(gc_session&);
+      swap_result swap_level(gc_session& session, ring_allocator& from, auto& to);
+      void*       try_move_object(session_lock_ref<>   session,
                             ring_allocator&      to,
                             const location_lock& lock,
                             void*                data,
                             std::uint32_t        size);
 
       void swap_loop();
+      void swap_worker(ring_allocator& from, auto& to);
 
       ring_allocator&   hot() { return _levels[hot_cache]; }
       ring_allocator&   warm() { return _levels[warm_cache]; }
@@ -123,22 +194,31 @@ namespace triedent
       ring_allocator   _levels[3];
       region_allocator _cold;
 
-      std::atomic<bool> _done{false};
-      std::thread       _swap_thread;
-      std::thread       _gc_thread;
+      hot_admission    _admission;
+      std::uint32_t    _admission_threshold;
+      frequency_sketch _sketch;
+      read_stats       _read_stats[num_read_stats];
+
+      std::atomic<bool>        _done{false};
+      std::vector<std::thread> _swap_threads;
+      std::thread              _gc_thread;
    };
 
    inline std::pair<location_lock, void*> cache_allocator::alloc(  //
        std::unique_lock<gc_queue::session>& session,
        std::size_t                          num_bytes,
-       node_type                            type)
+       node_type                            type,
+       placement                            where)
    {
       if (num_bytes > 0xffffff - 8) [[unlikely]]
          throw std::runtime_error("obj too big");
 
-      object_id i = _obj_ids.alloc(session, type);
-      hot().allocate(session, i, num_bytes,
-                     [&](void*, object_location loc) { _obj_ids.init(i, loc); });
+      object_id i    = _obj_ids.alloc(session, type);
+      auto      init = [&](void*, object_location loc) { _obj_ids.init(i, loc); };
+      if (where == placement::cold)
+         cold().try_allocate(session, i, num_bytes, init);
+      else
+         hot().allocate(session, i, num_bytes, init);
 
       auto lock = _obj_ids.lock(i);
       return {std::move(lock), get_object(_obj_ids.get(i))->data()};
@@ -157,25 +237,36 @@ namespace triedent
    // The returned pointer will remain valid until the session lock is released
    template <bool CopyToHot>
    std::tuple<void*, node_type, uint16_t> cache_allocator::get_cache(session_lock_ref<> session,
-                                                                     id                 i)
+                                                                     id                 i,
+                                                                     bool               admit_all)
    {
       auto loc = _obj_ids.get(i);
       auto obj = get_object(loc);
 
       if constexpr (CopyToHot)
       {
-         if (loc.cache != hot_cache && obj->size <= 4096)
+         auto& stats = local_read_stats();
+         if (loc.cache == hot_cache)
+         {
+            stats.hot_reads.fetch_add(1, std::memory_order_relaxed);
+         }
+         else
          {
-            // MUST NOT wait for free memory while holding a location lock
-            if (auto copy =
-                    try_move_object(session, hot(), _obj_ids.lock(i), obj->data(), obj->size))
+            stats.cold_reads.fetch_add(1, std::memory_order_relaxed);
+            if (obj->size <= 4096 && (admit_all || admit(i)))
             {
-               if constexpr (debug_cache)
+               // MUST NOT wait for free memory while holding a location lock
+               if (auto copy =
+                       try_move_object(session, hot(), _obj_ids.lock(i), obj->data(), obj->size))
                {
-                  std::osyncstream(std::cout)
-                      << "copied to hot: " << loc.cache << ":" << loc.offset() << std::endl;
+                  stats.promoted.fetch_add(1, std::memory_order_relaxed);
+                  if constexpr (debug_cache)
+                  {
+                     std::osyncstream(std::cout)
+                         << "copied to hot: " << loc.cache << ":" << loc.offset() << std::endl;
+                  }
+                  return {copy, {loc.type()}, static_cast<std::uint16_t>(loc.ref)};
                }
-               return {copy, {loc.type()}, static_cast<std::uint16_t>(loc.ref)};
             }
          }
       }
@@ -1,11 +1,23 @@
 #pragma once
 
 #include <algorithm>
+#include <bit>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
 #include <memory>
 #include <optional>
 #include <span>
+#include <thread>
 #include <triedent/node.hpp>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace triedent
 {
    inline constexpr bool debug_roots = false;
@@ -27,6 +39,7 @@ namespace triedent
    struct mutable_deref;
 
    inline key_type from_key6(const key_view sixb);
+   inline key_view to_key6(key_type& key_buf, key_view v);
 
    // Write thread usage notes:
    // * To create a new tree, default-initialize a shared_ptr<root>
@@ -55,10 +68,13 @@ namespace triedent
    //
    // Thread safety notes:
    // * If you share a read_session or write_session between threads, then you must
-   //   synchronize access to it. Since a database only allows at most a single
-   //   write_session at a time, only 1 thread at a time may write.
-   // * Recommendation: only have a single write thread and give each read thread
-   //   its own read_session.
+   //   synchronize access to it.
+   // * A database may have several write_sessions at once, so several threads may
+   //   write if each has its own write_session. They may start from copies of the
+   //   same shared_ptr<root>. A node is only edited in place if its refcount and
+   //   the use_count of its root are both 1, so a change never shows up in another
+   //   thread's tree; the other nodes are cloned.
+   // * Recommendation: give each thread its own read_session or write_session.
    // * If you share any std::shared_ptr between threads, then you must synchronize
    //   access to it. e.g. don't pass a non-const reference to std::shared_ptr to
    //   any functions in this library if that shared_ptr is currently being used by
@@ -168,6 +184,17 @@ namespace triedent
       std::optional<std::vector<char>> get(const std::shared_ptr<root>& r,
                                            std::span<const char>        key) const;
 
+      // Objects in the cache are not moved or freed while a read_lock
+      // is held, so views into them remain valid until the lock is
+      // released or the tree they belong to is modified.
+      using read_lock = std::unique_lock<gc_session>;
+      read_lock lock_cache() const { return read_lock{*this}; }
+
+      // Returns a view of the value stored at key without copying it.
+      std::optional<std::string_view> get_view(read_lock&                   l,
+                                               const std::shared_ptr<root>& r,
+                                               std::span<const char>        key) const;
+
       bool get_greater_equal(const std::shared_ptr<root>&        r,
                              std::span<const char>               key,
                              std::vector<char>*                  result_key,
@@ -184,6 +211,22 @@ namespace triedent
                    std::vector<char>*                  result_bytes,
                    std::vector<std::shared_ptr<root>>* result_roots) const;
 
+      class cursor;
+
+      // Reads normally copy the nodes they visit from colder levels into
+      // the hot level (subject to the database's admission policy).
+      // Sessions which serve queries should turn this off, so that they
+      // don't evict the nodes that the writer needs.
+      void set_promote(bool promote) { _promote = promote; }
+      bool promote() const { return _promote; }
+
+      // Promote every node that is read, regardless of the database's
+      // admission policy. Write sessions do this by default, so the
+      // writer's working set is cached as it was before admission
+      // control existed.
+      void set_admit_all(bool admit_all) { _admit_all = admit_all; }
+      bool admit_all() const { return _admit_all; }
+
       void print(const std::shared_ptr<root>& r);
       void validate(const std::shared_ptr<root>& r);
 
@@ -199,6 +242,8 @@ namespace triedent
       inline deref<node> get_by_id(session_lock_ref<> l, object_id i) const;
       inline deref<node> get_by_id(session_lock_ref<> l, object_id i, bool& unique) const;
 
+      deref<node> unguarded_find(session_lock_ref<> l, object_id root, std::string_view key) const;
+
       bool unguarded_get(session_lock_ref<>                            l,
                          const std::shared_ptr<triedent::root>&        ancestor,
                          object_id                                     root,
@@ -244,15 +289,113 @@ namespace triedent
 
       friend class database;
       std::shared_ptr<database> _db;
+      bool                      _promote   = true;
+      bool                      _admit_all = false;
 
       cache_allocator& ring() const;
    };
    using read_session = session<read_access>;
 
+   // A position within a tree which can move to adjacent keys without
+   // searching from the root again. The cursor holds a reference to the root,
+   // which prevents the nodes it walks through from being freed or edited in
+   // place, and remembers the inner nodes between the root and the current
+   // key. Moving to the next or previous key only revisits the part of that
+   // path which differs, so a full scan is amortized O(1) per key.
+   //
+   // The cursor sees the tree as it was when the cursor was created. It
+   // must not outlive the session that created it.
+   template <typename AccessMode>
+   class session<AccessMode>::cursor
+   {
+     public:
+      cursor(const session& s, std::shared_ptr<root> r) : _session(&s), _root(std::move(r)) {}
+
+      // Moves to the first key >= key
+      bool lower_bound(std::span<const char> key);
+      bool first();
+      bool last();
+
+      // next() on the last key and prev() on the first key invalidate the
+      // cursor. next() on an invalid cursor moves to the first key and
+      // prev() moves to the last key.
+      bool next();
+      bool prev();
+
+      bool valid() const { return bool(_value); }
+      void get_key(std::vector<char>& result_key) const;
+      void get_value(std::vector<char>*                  result_bytes,
+                     std::vector<std::shared_ptr<root>>* result_roots) const;
+
+     private:
+      struct frame
+      {
+         object_id id;
+         uint32_t  key_end;  // size of _key6 including this node's key
+         int8_t    branch;   // -1 if positioned at this node's value
+      };
+
+      void clear();
+      bool descend(session_lock_ref<> l, object_id id, bool to_last);
+      bool up_next(session_lock_ref<> l);
+      bool up_prev(session_lock_ref<> l);
+
+      const session*        _session;
+      std::shared_ptr<root> _root;
+      std::vector<frame>    _path;
+      key_type              _key6;
+      object_id             _value;
+   };
+
+   // A single change for write_session::apply. If value is nullopt,
+   // then key is removed.
+   struct mutation
+   {
+      std::span<const char>                key;
+      std::optional<std::span<const char>> value;
+   };
+
+   // Collects upserts and removes so they can be written by
+   // write_session::apply in a single pass. A later change to
+   // a key replaces any earlier change to the same key.
+   class write_batch
+   {
+     public:
+      void upsert(std::span<const char> key, std::span<const char> val)
+      {
+         changes.insert_or_assign(std::string{key.data(), key.size()},
+                                  std::string{val.data(), val.size()});
+      }
+      void remove(std::span<const char> key)
+      {
+         changes.insert_or_assign(std::string{key.data(), key.size()}, std::nullopt);
+      }
+
+      // Returns nullptr if key has no pending change. Otherwise returns the
+      // pending value, which is nullopt if key is pending removal.
+      const std::optional<std::string>* find(std::span<const char> key) const
+      {
+         auto it = changes.find(std::string_view{key.data(), key.size()});
+         if (it == changes.end())
+            return nullptr;
+         return &it->second;
+      }
+
+      bool        empty() const { return changes.empty(); }
+      std::size_t size() const { return changes.size(); }
+      void        clear() { changes.clear(); }
+
+     private:
+      friend write_session;
+
+      // Ordered by the 8-bit key, which is also the order of the 6-bit keys
+      std::map<std::string, std::optional<std::string>, std::less<>> changes;
+   };
+
    class write_session : public read_session
    {
      public:
-      write_session(std::shared_ptr<database> db) : read_session(db) {}
+      write_session(std::shared_ptr<database> db) : read_session(db) { set_admit_all(true); }
 
       std::shared_ptr<root> get_top_root();
       void                  set_top_root(const std::shared_ptr<root>& r);
@@ -271,24 +414,57 @@ namespace triedent
 
       int remove(std::shared_ptr<root>& r, std::span<const char> key);
 
+      // Applies all mutations in a single top-down pass. Each inner node on a
+      // path shared by several keys is visited, and if necessary cloned, only
+      // once. If a key appears more than once, the last mutation wins.
+      void apply(std::shared_ptr<root>& r, std::span<const mutation> mutations);
+      void apply(std::shared_ptr<root>& r, const write_batch& batch);
+
+      // Nodes written by this session go to the hot level by default. Trees
+      // that are appended to and rarely read can write to cold instead, so
+      // that they don't evict the working set of other trees.
+      void      set_placement(placement where) { _placement = where; }
+      placement get_placement() const { return _placement; }
+
       /**
           *  These methods are used to recover the database after a crash,
           *  start_collect_garbage resets all non-zero refcounts to 1,
           *  then you can call recursve retain for all root nodes that need
           *  to be kept.
+          *
+          *  recursive_retain walks the tree on num_threads threads, which
+          *  steal subtrees from each other. progress, if provided, is called
+          *  from one of the walking threads with the number of nodes visited
+          *  so far, about once every gc_progress_interval nodes.
           */
       ///@{
+      static constexpr std::uint64_t gc_progress_interval = 1 << 20;
+
       void start_collect_garbage();
-      void recursive_retain();
+      void recursive_retain(std::uint32_t                             num_threads = 1,
+                            const std::function<void(std::uint64_t)>& progress    = {});
       void end_collect_garbage();
       ///@}
 
      private:
+      // Visits every node that is reachable from roots. first_visit is
+      // called once per reference and must return true only the first
+      // time that it sees a node, which is when its children are queued.
+      template <typename F>
+      void mark_reachable(std::span<const object_id>                roots,
+                          std::uint32_t                             num_threads,
+                          F&&                                       first_visit,
+                          const std::function<void(std::uint64_t)>& progress);
+
+      struct key6_mutation
+      {
+         key_type                  key;
+         std::optional<string_view> value;
+      };
+
       inline bool get_unique(std::shared_ptr<root>& r);
       inline void update_root(session_lock_ref<> l, std::shared_ptr<root>& r, object_id id);
 
-      void recursive_retain(session_lock_ref<> l, object_id id);
-
       mutable_deref<value_node> make_value(std::unique_lock<gc_session>& session,
                                            node_type                     type,
                                            string_view                   k,
@@ -339,6 +515,18 @@ namespace triedent
                              string_view                   key,
                              int&                          removed_size);
 
+      inline void apply_sorted(std::shared_ptr<root>& r, std::span<const key6_mutation> muts);
+      inline id   apply_batch(std::unique_lock<gc_session>&  session,
+                              id                             root,
+                              bool                           unique,
+                              std::span<const key6_mutation> muts,
+                              std::uint32_t                  offset);
+      inline id   apply_branches(std::unique_lock<gc_session>&  session,
+                                 deref<inner_node>              in,
+                                 bool                           unique,
+                                 std::span<const key6_mutation> muts,
+                                 std::uint32_t                  offset);
+
       inline void modify_value(session_lock_ref<>        l,
                                mutable_deref<value_node> mut,
                                string_view               val);
@@ -362,6 +550,8 @@ namespace triedent
                                       string_view                   k2,
                                       string_view                   v2,
                                       object_id                     origin2);
+
+      placement _placement = placement::hot;
    };
 
    class database : public std::enable_shared_from_this<database>
@@ -419,7 +609,6 @@ namespace triedent
       database_memory* _dbm;
 
       mutable std::mutex _root_change_mutex;
-      bool               _have_write_session;
 
       std::mutex   _root_release_session_mutex;
       session_base _root_release_session;
@@ -547,14 +736,16 @@ namespace triedent
    template <typename AccessMode>
    inline deref<node> session<AccessMode>::get_by_id(session_lock_ref<> l, id i) const
    {
-      auto [ptr, type, ref] = ring().template get_cache<true>(l, i);
+      auto [ptr, type, ref] = _promote ? ring().template get_cache<true>(l, i, _admit_all)
+                                       : ring().template get_cache<false>(l, i);
       return {i, ptr, type};
    }
 
    template <typename AccessMode>
    inline deref<node> session<AccessMode>::get_by_id(session_lock_ref<> l, id i, bool& unique) const
    {
-      auto [ptr, type, ref] = ring().template get_cache<true>(l, i);
+      auto [ptr, type, ref] = _promote ? ring().template get_cache<true>(l, i, _admit_all)
+                                       : ring().template get_cache<false>(l, i);
       unique &= ref == 1;
       return {i, ptr, type};
    }
@@ -595,9 +786,39 @@ namespace triedent
    }
 
    // This always returns a view into the first argument
+   //
+   // Compares 16 (or 8) bytes at a time, since most calls compare whole
+   // node prefixes that match.
    inline std::string_view common_prefix(std::string_view a, std::string_view b)
    {
-      return {a.begin(), std::mismatch(a.begin(), a.end(), b.begin(), b.end()).first};
+      const char*       pa = a.data();
+      const char*       pb = b.data();
+      const std::size_t n  = std::min(a.size(), b.size());
+      std::size_t       i  = 0;
+#ifdef __SSE2__
+      for (; i + 16 <= n; i += 16)
+      {
+         auto va   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + i));
+         auto vb   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + i));
+         auto diff = ~_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xffff;
+         if (diff)
+            return {pa, i + std::countr_zero(static_cast<std::uint32_t>(diff))};
+      }
+#endif
+      if constexpr (std::endian::native == std::endian::little)
+      {
+         for (; i + 8 <= n; i += 8)
+         {
+            std::uint64_t wa, wb;
+            std::memcpy(&wa, pa + i, 8);
+            std::memcpy(&wb, pb + i, 8);
+            if (auto diff = wa ^ wb)
+               return {pa, i + std::countr_zero(diff) / 8};
+         }
+      }
+      while (i < n && pa[i] == pb[i])
+         ++i;
+      return {pa, i};
    }
 
    inline std::shared_ptr<root> write_session::get_top_root()
@@ -692,7 +913,7 @@ namespace triedent
                                                               string_view                   key,
                                                               string_view                   val)
    {
-      return {value_node::make(ring(), session, key, val, type), type};
+      return {value_node::make(ring(), session, key, val, type, _placement), type};
    }
 
    inline mutable_deref<value_node> write_session::clone_value(
@@ -703,7 +924,8 @@ namespace triedent
        std::uint32_t                 key_offset,
        string_view                   val)
    {
-      return {value_node::clone(ring(), session, origin, key, key_offset, val, type), type};
+      return {value_node::clone(ring(), session, origin, key, key_offset, val, type, _placement),
+              type};
    }
 
    inline mutable_deref<value_node> write_session::clone_value(
@@ -713,7 +935,7 @@ namespace triedent
        const std::string&            key,
        string_view                   val)
    {
-      return {value_node::clone(ring(), session, origin, key, -1, val, type), type};
+      return {value_node::clone(ring(), session, origin, key, -1, val, type, _placement), type};
    }
 
    inline mutable_deref<inner_node> write_session::make_inner(std::unique_lock<gc_session>& session,
@@ -721,7 +943,7 @@ namespace triedent
                                                               id                            val,
                                                               uint64_t branches)
    {
-      return inner_node::make(ring(), session, pre, val, branches);
+      return inner_node::make(ring(), session, pre, val, branches, _placement);
    }
 
    inline mutable_deref<inner_node> write_session::clone_inner(
@@ -733,7 +955,7 @@ namespace triedent
        object_id                     val,
        uint64_t                      branches)
    {
-      return inner_node::clone(ring(), session, id, &cpy, pre, offset, val, branches);
+      return inner_node::clone(ring(), session, id, &cpy, pre, offset, val, branches, _placement);
    }
 
    inline mutable_deref<inner_node> write_session::clone_inner(
@@ -744,7 +966,7 @@ namespace triedent
        object_id                     val,
        uint64_t                      branches)
    {
-      return inner_node::clone(ring(), session, id, &cpy, pre, -1, val, branches);
+      return inner_node::clone(ring(), session, id, &cpy, pre, -1, val, branches, _placement);
    }
 
    template <typename T>
@@ -1091,6 +1313,18 @@ namespace triedent
                            result_roots);
    }
 
+   template <typename AccessMode>
+   std::optional<std::string_view> session<AccessMode>::get_view(read_lock&                   l,
+                                                                 const std::shared_ptr<root>& r,
+                                                                 std::span<const char> key) const
+   {
+      auto n = unguarded_find(l, get_id(r), to_key6({key.data(), key.size()}));
+      if (!n)
+         return std::nullopt;
+      auto& vn = n.as_value_node();
+      return std::string_view{vn.data_ptr(), vn.data_size()};
+   }
+
    template <typename AccessMode>
    bool session<AccessMode>::unguarded_get(
        session_lock_ref<>                            l,
@@ -1100,31 +1334,42 @@ namespace triedent
        std::vector<char>*                            result_bytes,
        std::vector<std::shared_ptr<triedent::root>>* result_roots) const
    {
-      if (not root)
+      auto n = unguarded_find(l, root, key);
+      if (!n)
          return false;
+      return fill_result(ancestor, n.as_value_node(), n.type(), result_bytes, result_roots);
+   }
+
+   // Returns the value node stored at key, or a null deref if there is none
+   template <typename AccessMode>
+   deref<node> session<AccessMode>::unguarded_find(session_lock_ref<> l,
+                                                   object_id          root,
+                                                   std::string_view   key) const
+   {
+      if (not root)
+         return {id(), nullptr, node_type::bytes};
 
       for (;;)
       {
          auto n = get_by_id(l, root);
          if (n.is_leaf_node())
          {
-            auto& vn = n.as_value_node();
-            if (vn.key() == key)
-               return fill_result(ancestor, vn, n.type(), result_bytes, result_roots);
-            return false;
+            if (n.as_value_node().key() == key)
+               return n;
+            return {id(), nullptr, node_type::bytes};
          }
          auto& in     = n.as_inner_node();
          auto  in_key = in.key();
 
          if (key.size() < in_key.size())
-            return false;
+            return {id(), nullptr, node_type::bytes};
 
          if (key == in_key)
          {
             root = in.value();
 
             if (not root)
-               return false;
+               return {id(), nullptr, node_type::bytes};
 
             key = string_view();
             continue;
@@ -1132,17 +1377,16 @@ namespace triedent
 
          auto cpre = common_prefix(key, in_key);
          if (cpre != in_key)
-            return false;
+            return {id(), nullptr, node_type::bytes};
 
          auto b = key[cpre.size()];
 
          if (not in.has_branch(b))
-            return false;
+            return {id(), nullptr, node_type::bytes};
 
          key  = key.substr(cpre.size() + 1);
          root = in.branch(b);
       }
-      return false;
    }
 
    template <typename AccessMode>
@@ -1174,6 +1418,199 @@ namespace triedent
       return true;
    }
 
+   template <typename AccessMode>
+   void session<AccessMode>::cursor::clear()
+   {
+      _path.clear();
+      _key6.clear();
+      _value = {};
+   }
+
+   // Pushes id and its leftmost (or rightmost) descendants onto the path
+   template <typename AccessMode>
+   bool session<AccessMode>::cursor::descend(session_lock_ref<> l, object_id id, bool to_last)
+   {
+      for (;;)
+      {
+         auto n = _session->get_by_id(l, id);
+         if (n.is_leaf_node())
+         {
+            _key6 += n.as_value_node().key();
+            _value = id;
+            return true;
+         }
+         auto& in = n.as_inner_node();
+         _key6 += in.key();
+         auto& f = _path.emplace_back(frame{id, (uint32_t)_key6.size(), -1});
+         if (in.value() && (!to_last || !in.num_branches()))
+         {
+            id = in.value();
+            continue;
+         }
+         f.branch = to_last ? in.reverse_lower_bound(63) : in.lower_bound(0);
+         _key6.push_back(f.branch);
+         id = in.branch(f.branch);
+      }
+   }
+
+   // Moves to the first key after the current branch of the top frame,
+   // popping frames which have no later branches
+   template <typename AccessMode>
+   bool session<AccessMode>::cursor::up_next(session_lock_ref<> l)
+   {
+      while (!_path.empty())
+      {
+         auto& f  = _path.back();
+         auto& in = _session->get_by_id(l, f.id).as_inner_node();
+         auto  b  = f.branch < 0 ? in.lower_bound(0) : in.upper_bound(f.branch);
+         if (b < 64)
+         {
+            f.branch = b;
+            _key6.resize(f.key_end);
+            _key6.push_back(b);
+            return descend(l, in.branch(b), false);
+         }
+         _path.pop_back();
+      }
+      clear();
+      return false;
+   }
+
+   // Moves to the last key before the current branch of the top frame,
+   // popping frames which have nothing earlier
+   template <typename AccessMode>
+   bool session<AccessMode>::cursor::up_prev(session_lock_ref<> l)
+   {
+      while (!_path.empty())
+      {
+         auto& f  = _path.back();
+         auto& in = _session->get_by_id(l, f.id).as_inner_node();
+         if (f.branch >= 0)
+         {
+            auto b = f.branch ? in.reverse_lower_bound(f.branch - 1) : -1;
+            _key6.resize(f.key_end);
+            if (b >= 0)
+            {
+               f.branch = b;
+               _key6.push_back(b);
+               return descend(l, in.branch(b), true);
+            }
+            if (in.value())
+            {
+               f.branch = -1;
+               return descend(l, in.value(), true);
+            }
+         }
+         _path.pop_back();
+      }
+      clear();
+      return false;
+   }
+
+   template <typename AccessMode>
+   bool session<AccessMode>::cursor::first()
+   {
+      swap_guard l(*_session);
+      clear();
+      if (auto id = _session->get_id(_root))
+         return descend(l, id, false);
+      return false;
+   }
+
+   template <typename AccessMode>
+   bool session<AccessMode>::cursor::last()
+   {
+      swap_guard l(*_session);
+      clear();
+      if (auto id = _session->get_id(_root))
+         return descend(l, id, true);
+      return false;
+   }
+
+   template <typename AccessMode>
+   bool session<AccessMode>::cursor::next()
+   {
+      if (!valid())
+         return first();
+      swap_guard l(*_session);
+      _value = {};
+      return up_next(l);
+   }
+
+   template <typename AccessMode>
+   bool session<AccessMode>::cursor::prev()
+   {
+      if (!valid())
+         return last();
+      swap_guard l(*_session);
+      _value = {};
+      return up_prev(l);
+   }
+
+   template <typename AccessMode>
+   bool session<AccessMode>::cursor::lower_bound(std::span<const char> key)
+   {
+      swap_guard l(*_session);
+      clear();
+      key_type buf;
+      auto     k  = triedent::to_key6(buf, {key.data(), key.size()});
+      auto     id = _session->get_id(_root);
+      if (!id)
+         return false;
+      for (;;)
+      {
+         auto n = _session->get_by_id(l, id);
+         if (n.is_leaf_node())
+         {
+            auto vk = n.as_value_node().key();
+            _key6 += vk;
+            _value = id;
+            if (vk >= k)
+               return true;
+            _value = {};
+            return up_next(l);
+         }
+         auto& in     = n.as_inner_node();
+         auto  in_key = in.key();
+         auto  cpre   = common_prefix(k, in_key);
+         if (cpre.size() < in_key.size())
+         {
+            // Every key in this subtree is either greater or less than k
+            if (cpre.size() == k.size() || in_key[cpre.size()] > k[cpre.size()])
+               return descend(l, id, false);
+            return up_next(l);
+         }
+         if (k.size() == in_key.size())
+            return descend(l, id, false);
+         uint8_t b = k[in_key.size()];
+         _key6 += in_key;
+         _path.push_back(frame{id, (uint32_t)_key6.size(), (int8_t)b});
+         // The value and any branches before b are less than k
+         if (!in.has_branch(b))
+            return up_next(l);
+         _key6.push_back(b);
+         k  = k.substr(in_key.size() + 1);
+         id = in.branch(b);
+      }
+   }
+
+   template <typename AccessMode>
+   void session<AccessMode>::cursor::get_key(std::vector<char>& result_key) const
+   {
+      auto s = from_key6(_key6);
+      result_key.assign(s.begin(), s.end());
+   }
+
+   template <typename AccessMode>
+   void session<AccessMode>::cursor::get_value(
+       std::vector<char>*                  result_bytes,
+       std::vector<std::shared_ptr<root>>* result_roots) const
+   {
+      swap_guard l(*_session);
+      auto       n = _session->get_by_id(l, _value);
+      _session->fill_result(_root, n.as_value_node(), n.type(), result_bytes, result_roots);
+   }
+
    template <typename AccessMode>
    bool session<AccessMode>::get_greater_equal(
        const std::shared_ptr<root>&        r,
@@ -1588,6 +2025,227 @@ namespace triedent
       return root;
    }
 
+   inline void write_session::apply(std::shared_ptr<root>& r, std::span<const mutation> mutations)
+   {
+      std::vector<key6_mutation> muts;
+      muts.reserve(mutations.size());
+      for (auto& m : mutations)
+      {
+         key6_mutation k;
+         triedent::to_key6(k.key, {m.key.data(), m.key.size()});
+         if (m.value)
+            k.value = string_view{m.value->data(), m.value->size()};
+         muts.push_back(std::move(k));
+      }
+      std::stable_sort(muts.begin(), muts.end(),
+                       [](const auto& a, const auto& b) { return a.key < b.key; });
+      // Keep only the last mutation of each key
+      auto out = muts.begin();
+      for (auto pos = muts.begin(); pos != muts.end(); ++pos)
+      {
+         if (pos + 1 != muts.end() && pos[1].key == pos->key)
+            continue;
+         if (out != pos)
+            *out = std::move(*pos);
+         ++out;
+      }
+      muts.erase(out, muts.end());
+      apply_sorted(r, muts);
+   }
+
+   inline void write_session::apply(std::shared_ptr<root>& r, const write_batch& batch)
+   {
+      std::vector<key6_mutation> muts;
+      muts.reserve(batch.size());
+      for (auto& [key, value] : batch.changes)
+      {
+         key6_mutation k;
+         triedent::to_key6(k.key, key);
+         if (value)
+            k.value = *value;
+         muts.push_back(std::move(k));
+      }
+      apply_sorted(r, muts);
+   }
+
+   inline void write_session::apply_sorted(std::shared_ptr<root>&         r,
+                                           std::span<const key6_mutation> muts)
+   {
+      if (muts.empty())
+         return;
+      std::unique_lock<gc_session> l(*this);
+
+      auto new_root = apply_batch(l, get_id(r), get_unique(r), muts, 0);
+      update_root(l, r, new_root);
+   }
+
+   /**
+    *  Applies muts, which are sorted by key and have the first offset digits
+    *  in common, to the subtree at root. Like add_child and remove_child, this
+    *  returns the new id of the subtree and leaves the reference to root for
+    *  the caller to release.
+    */
+   inline database::id write_session::apply_batch(std::unique_lock<gc_session>&  session,
+                                                  id                             root,
+                                                  bool                           unique,
+                                                  std::span<const key6_mutation> muts,
+                                                  std::uint32_t                  offset)
+   {
+      if (root && muts.size() > 1)
+      {
+         auto n = get_by_id(session, root, unique);
+         if (!n.is_leaf_node())
+         {
+            deref<inner_node> in{n};
+            auto              in_key = in->key();
+            bool              below  = std::all_of(muts.begin(), muts.end(),
+                                                   [&](const key6_mutation& m)
+                                                   {
+                                                      auto k = string_view{m.key}.substr(offset);
+                                                      return k.size() > in_key.size() &&
+                                                             k.starts_with(in_key);
+                                                   });
+            if (below)
+               return apply_branches(session, in, unique, muts, offset + in_key.size());
+         }
+      }
+
+      // Either there is nothing to share, or the node itself changes shape.
+      // Apply one mutation at a time. Only the first one can find shared
+      // nodes; everything it creates is unique to this batch.
+      id cur = root;
+      for (auto& m : muts)
+      {
+         int  size = -1;
+         auto key  = string_view{m.key}.substr(offset);
+         auto next = m.value ? add_child(session, cur, unique, node_type::bytes, key, *m.value, size)
+                             : remove_child(session, cur, unique, key, size);
+         if (next != cur)
+         {
+            if (cur != root)
+               release(session, cur);
+            cur    = next;
+            unique = true;
+         }
+      }
+      return cur;
+   }
+
+   /**
+    *  Applies muts to the branches of in. Every key in muts extends in's
+    *  prefix, and the digit at offset selects the branch.
+    */
+   inline database::id write_session::apply_branches(std::unique_lock<gc_session>&  session,
+                                                     deref<inner_node>              in,
+                                                     bool                           unique,
+                                                     std::span<const key6_mutation> muts,
+                                                     std::uint32_t                  offset)
+   {
+      struct branch_change
+      {
+         std::uint8_t branch;
+         id           old_id;
+         id           new_id;
+      };
+      branch_change changes[64];
+      int           num_changes = 0;
+
+      for (auto pos = muts.begin(); pos != muts.end();)
+      {
+         std::uint8_t b   = pos->key[offset];
+         auto         end = std::find_if(pos, muts.end(), [&](const key6_mutation& m)
+                                         { return std::uint8_t(m.key[offset]) != b; });
+         // Allocation within earlier branches invalidates in
+         in.reload(ring(), session);
+         id cur_b = in->has_branch(b) ? in->branch(b) : id{};
+         id new_b = apply_batch(session, cur_b, unique, {pos, end}, offset + 1);
+         if (new_b != cur_b)
+            changes[num_changes++] = {b, cur_b, new_b};
+         pos = end;
+      }
+      if (!num_changes)
+         return in;
+
+      in.reload(ring(), session);
+      auto new_branches = in->branches();
+      for (auto& c : std::span{changes, changes + num_changes})
+      {
+         if (c.new_id)
+            new_branches |= inner_node::branches(c.branch);
+         else
+            new_branches &= ~inner_node::branches(c.branch);
+      }
+
+      if (std::popcount(new_branches) + bool(in->value()) > 1)
+      {
+         if (unique && new_branches == in->branches())
+         {
+            {
+               auto locked = lock(in);
+               for (auto& c : std::span{changes, changes + num_changes})
+                  locked->branch(c.branch) = c.new_id;
+            }
+            for (auto& c : std::span{changes, changes + num_changes})
+               release(session, c.old_id);
+            return in;
+         }
+
+         // A single clone covers every changed branch
+         auto new_in = clone_inner(session, in, *in, in->key(), 0, in->value(), new_branches);
+         for (auto& c : std::span{changes, changes + num_changes})
+         {
+            if (!c.new_id)
+               continue;
+            auto& br   = new_in->branch(c.branch);
+            auto  prev = br;
+            br         = c.new_id;
+            // clone_inner bumped (or copied) the old branch
+            release(session, prev);
+         }
+         return new_in;
+      }
+
+      if (!new_branches && !in->value())
+         return id();
+
+      if (!new_branches)
+      {
+         // Only the value remains
+         auto        cur_v = get_by_id(session, in->value());
+         auto&       cv    = cur_v.as_value_node();
+         std::string new_key{in->key()};
+         return clone_value(session, cur_v, cur_v.type(), new_key, cv.data());
+      }
+
+      // Only one branch remains; merge it with this node
+      std::uint8_t lb = std::countr_zero(new_branches);
+      std::string  new_key;
+      new_key += in->key();
+      new_key += char(lb);
+      auto changed = std::find_if(changes, changes + num_changes,
+                                  [&](const branch_change& c) { return c.branch == lb; });
+      bool owned   = changed != changes + num_changes;
+      id   child   = owned ? changed->new_id : in->branch(lb);
+      auto cur_v   = get_by_id(session, child);
+      id   result;
+      if (cur_v.is_leaf_node())
+      {
+         auto& cv = cur_v.as_value_node();
+         new_key += cv.key();
+         result = clone_value(session, cur_v, cur_v.type(), new_key, cv.data());
+      }
+      else
+      {
+         auto& cv = cur_v.as_inner_node();
+         new_key += cv.key();
+         result = clone_inner(session, cur_v, cv, new_key, cv.value(), cv.branches());
+      }
+      // The merged node replaces the new child that was built above
+      if (owned)
+         release(session, child);
+      return result;
+   }  // write_session::apply_branches
+
    template <typename AccessMode>
    void session<AccessMode>::print(const std::shared_ptr<root>& r)
    {
@@ -1653,43 +2311,195 @@ namespace triedent
     * visit every node in the tree and retain it. This is used in garbage collection
     * after a crash.
     */
-   inline void write_session::recursive_retain()
+   inline void write_session::recursive_retain(
+       std::uint32_t                             num_threads,
+       const std::function<void(std::uint64_t)>& progress)
    {
       object_id id;
       {
          std::lock_guard<std::mutex> lock(_db->_root_change_mutex);
          id = {_db->_dbm->top_root.load()};
       }
-      swap_guard l{*this};
-      recursive_retain(l, id);
+      if (!id)
+         return;
+      mark_reachable({&id, 1}, num_threads, [&](object_id r) { return ring().gc_retain(r); },
+                     progress);
    }
 
-   inline void write_session::recursive_retain(session_lock_ref<> l, id r)
+   /*
+    * Each thread keeps its own queue of nodes to visit. It takes the most
+    * recently found node from its own queue, which keeps the walk depth-first,
+    * and steals the oldest node from another queue when its own is empty.
+    * Older nodes are closer to the root, so a steal usually takes a large
+    * subtree. first_visit is atomic and reports the first visit of each node,
+    * so a node's children are only queued once even if it is reachable from
+    * nodes that are visited concurrently.
+    *
+    * A thread that finds no work sleeps until another thread queues more, or
+    * until the walk is done.
+    */
+   template <typename F>
+   void write_session::mark_reachable(std::span<const object_id>                roots,
+                                      std::uint32_t                             num_threads,
+                                      F&&                                       first_visit,
+                                      const std::function<void(std::uint64_t)>& progress)
    {
-      if (not r)
+      num_threads = std::max(num_threads, std::uint32_t{1});
+
+      struct work_queue
+      {
+         std::mutex            mutex;
+         std::deque<object_id> ids;
+      };
+      std::vector<work_queue>    queues(num_threads);
+      std::atomic<std::uint64_t> pending{0};
+      std::atomic<std::uint64_t> visited{0};
+      std::atomic<bool>          failed{false};
+      std::exception_ptr         error;
+      std::mutex                 error_mutex;
+      std::mutex                 idle_mutex;
+      std::condition_variable    idle_cv;
+      std::atomic<std::uint32_t> sleeping{0};
+      for (auto id : roots)
+      {
+         if (id)
+         {
+            queues[0].ids.push_back(id);
+            ++pending;
+         }
+      }
+      if (pending.load() == 0)
          return;
 
-      if (!ring().gc_retain(r))
-         return;  // retaining this node indirectly retains all children
+      auto wake_all = [&]
+      {
+         std::lock_guard l{idle_mutex};
+         idle_cv.notify_all();
+      };
 
-      auto dr = get_by_id(l, r);
-      if (dr.type() == node_type::inner)
+      auto take = [&](std::uint32_t self) -> object_id
       {
-         auto& in = dr.as_inner_node();
-         recursive_retain(l, in.value());
-         for (auto child : std::span{in.children(), in.num_branches()})
          {
-            recursive_retain(l, child);
+            std::lock_guard l{queues[self].mutex};
+            if (!queues[self].ids.empty())
+            {
+               auto result = queues[self].ids.back();
+               queues[self].ids.pop_back();
+               return result;
+            }
+         }
+         for (std::uint32_t i = 1; i < num_threads; ++i)
+         {
+            auto&           victim = queues[(self + i) % num_threads];
+            std::lock_guard l{victim.mutex};
+            if (!victim.ids.empty())
+            {
+               auto result = victim.ids.front();
+               victim.ids.pop_front();
+               return result;
+            }
          }
-      }
-      else if (dr.type() == node_type::roots)
+         return {};
+      };
+
+      auto have_work = [&]
       {
-         auto& rt = dr.as_value_node();
-         for (auto child : std::span{rt.roots(), rt.num_roots()})
+         for (auto& q : queues)
          {
-            recursive_retain(l, child);
+            std::lock_guard l{q.mutex};
+            if (!q.ids.empty())
+               return true;
          }
-      }
+         return false;
+      };
+
+      auto visit = [&](session_lock_ref<> l, std::uint32_t self, object_id r)
+      {
+         if (!first_visit(r))
+            return;  // visiting this node again would visit all its children again
+
+         auto [ptr, type, ref] = ring().get_cache<false>(l, r);
+         deref<node>                dr{r, ptr, type};
+         std::span<const object_id> children;
+         std::optional<object_id>   value;
+         if (dr.type() == node_type::inner)
+         {
+            auto& in = dr.as_inner_node();
+            value    = in.value();
+            children = {in.children(), in.num_branches()};
+         }
+         else if (dr.type() == node_type::roots)
+         {
+            auto& rt = dr.as_value_node();
+            children = {rt.roots(), rt.num_roots()};
+         }
+         std::size_t added = 0;
+         {
+            std::lock_guard ql{queues[self].mutex};
+            auto&           ids = queues[self].ids;
+            auto            n   = ids.size();
+            if (value && *value)
+               ids.push_back(*value);
+            for (auto child : children)
+               if (child)
+                  ids.push_back(child);
+            added = ids.size() - n;
+            pending.fetch_add(added);
+         }
+         // A sleeping thread counts itself before it checks the queues, so
+         // either it sees these nodes or this sees it.
+         if (added && sleeping.load())
+            wake_all();
+      };
+
+      auto run = [&](std::uint32_t self)
+      {
+         auto session = ring().start_session();
+         while (pending.load() != 0 && !failed.load())
+         {
+            auto r = take(self);
+            if (!r)
+            {
+               std::unique_lock l{idle_mutex};
+               sleeping.fetch_add(1);
+               idle_cv.wait(l, [&]
+                            { return pending.load() == 0 || failed.load() || have_work(); });
+               sleeping.fetch_sub(1);
+               continue;
+            }
+            try
+            {
+               std::lock_guard l{session};
+               visit(l, self, r);
+            }
+            catch (...)
+            {
+               {
+                  std::lock_guard l{error_mutex};
+                  if (!error)
+                     error = std::current_exception();
+               }
+               failed.store(true);
+               wake_all();
+            }
+            if (pending.fetch_sub(1) == 1)
+               wake_all();
+            auto n = visited.fetch_add(1) + 1;
+            if (progress && n % gc_progress_interval == 0)
+               progress(n);
+         }
+      };
+
+      std::vector<std::thread> threads;
+      for (std::uint32_t i = 1; i < num_threads; ++i)
+         threads.emplace_back(run, i);
+      run(0);
+      for (auto& t : threads)
+         t.join();
+      if (error)
+         std::rethrow_exception(error);
+      if (progress)
+         progress(visited.load());
    }
 
    inline void write_session::start_collect_garbage()
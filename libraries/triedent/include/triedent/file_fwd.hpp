@@ -4,13 +4,25 @@
 
 namespace triedent
 {
-   inline constexpr std::uint32_t file_magic              = 0x3088cf00;
+   // Version 1 added packed inner nodes, which older versions can't read.
+   // Version 0 files are still readable and are upgraded when they are
+   // opened for writing.
+   inline constexpr std::uint32_t file_magic              = 0x3088cf01;
+   inline constexpr std::uint32_t file_magic_v0           = 0x3088cf00;
    inline constexpr std::uint32_t file_type_mask          = 0xFF;
    inline constexpr std::uint32_t file_type_database_root = 1;
    inline constexpr std::uint32_t file_type_index         = 2;
    inline constexpr std::uint32_t file_type_data          = 3;
    inline constexpr std::uint32_t file_type_cold          = 4;
 
+   // Returns false if magic doesn't belong to a triedent file
+   inline bool check_file_magic(std::uint32_t& magic, bool writable)
+   {
+      if (magic == file_magic_v0 && writable)
+         magic = file_magic;
+      return magic == file_magic || magic == file_magic_v0;
+   }
+
    inline constexpr std::size_t round_to_page(std::size_t arg)
    {
       constexpr std::size_t page_size = 4096;
@@ -32,5 +44,8 @@ namespace triedent
       std::uint64_t free_bytes;
       std::uint64_t available_bytes;
       std::uint64_t num_objects;
+      // Allocations which had to wait for the swap workers to free memory
+      std::uint64_t stall_count;
+      std::uint64_t stall_ns;
    };
 }  // namespace triedent
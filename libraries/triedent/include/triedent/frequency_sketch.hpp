@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+
+namespace triedent
+{
+   // Estimates how often each key has been accessed recently (TinyLFU).
+   //
+   // This is a count-min sketch of 4-bit counters. Each key maps to four
+   // counters and the estimate is the smallest of them, so collisions can
+   // only make an estimate too high. After sample_size increments, every
+   // counter is halved, which makes old accesses count less than recent ones.
+   //
+   // All operations are thread-safe. Concurrent increments of the same
+   // word are not lost, but an increment that races with halving may be.
+   class frequency_sketch
+   {
+     public:
+      static constexpr std::uint32_t max_count = 15;
+
+      // num_counters is rounded up to a power of 2
+      explicit frequency_sketch(std::uint64_t num_counters)
+          : _mask(std::bit_ceil(std::max(num_counters / counters_per_word, std::uint64_t{64})) - 1),
+            _sample_size((_mask + 1) * counters_per_word / 2),
+            _table(new std::atomic<std::uint64_t>[_mask + 1])
+      {
+         for (std::uint64_t i = 0; i <= _mask; ++i)
+            _table[i].store(0, std::memory_order_relaxed);
+      }
+
+      // Records an access and returns the updated estimate
+      std::uint32_t increment(std::uint64_t key)
+      {
+         std::uint32_t result = max_count;
+         for_each_counter(key,
+                          [&](std::atomic<std::uint64_t>& word, unsigned shift)
+                          {
+                             auto value = word.load(std::memory_order_relaxed);
+                             std::uint32_t count;
+                             do
+                             {
+                                count = (value >> shift) & max_count;
+                                if (count == max_count)
+                                   break;
+                             } while (!word.compare_exchange_weak(value,
+                                                                  value + (std::uint64_t{1} << shift),
+                                                                  std::memory_order_relaxed));
+                             result = std::min(result, std::min(count + 1, max_count));
+                          });
+         if (_additions.fetch_add(1, std::memory_order_relaxed) + 1 == _sample_size)
+            halve();
+         return result;
+      }
+
+      std::uint32_t estimate(std::uint64_t key) const
+      {
+         std::uint32_t result = max_count;
+         for_each_counter(key,
+                          [&](std::atomic<std::uint64_t>& word, unsigned shift)
+                          {
+                             auto value = word.load(std::memory_order_relaxed);
+                             result     = std::min(result, std::uint32_t((value >> shift) & max_count));
+                          });
+         return result;
+      }
+
+     private:
+      static constexpr std::uint64_t counters_per_word = 16;
+
+      static std::uint64_t mix(std::uint64_t x)
+      {
+         // splitmix64 finalizer
+         x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+         x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+         return x ^ (x >> 31);
+      }
+
+      // Double hashing picks four counters from two hashes
+      template <typename F>
+      void for_each_counter(std::uint64_t key, F&& f) const
+      {
+         std::uint64_t h1 = mix(key);
+         std::uint64_t h2 = mix(h1) | 1;
+         for (int i = 0; i < 4; ++i)
+         {
+            std::uint64_t h = h1 + i * h2;
+            f(_table[(h >> 4) & _mask], unsigned(h & (counters_per_word - 1)) * 4);
+         }
+      }
+
+      void halve()
+      {
+         for (std::uint64_t i = 0; i <= _mask; ++i)
+         {
+            auto value = _table[i].load(std::memory_order_relaxed);
+            _table[i].store((value >> 1) & 0x7777'7777'7777'7777ull, std::memory_order_relaxed);
+         }
+         _additions.fetch_sub(_sample_size / 2, std::memory_order_relaxed);
+      }
+
+      const std::uint64_t                           _mask;
+      const std::uint64_t                           _sample_size;
+      std::unique_ptr<std::atomic<std::uint64_t>[]> _table;
+      std::atomic<std::uint64_t>                    _additions{0};
+   };
+
+}  // namespace triedent
@@ -56,11 +56,12 @@ namespace triedent
           std::unique_lock<gc_session>& session,
           key_view                      key,
           value_view                    val,
-          node_type                     type)
+          node_type                     type,
+          placement                     where = placement::hot)
       {
          assert(val.size() < 0xffffff - key.size() - sizeof(value_node));
          uint32_t alloc_size = sizeof(value_node) + key.size() + val.size();
-         auto     r          = a.alloc(session, alloc_size, type);
+         auto     r          = a.alloc(session, alloc_size, type, where);
          if constexpr (debug_nodes)
             std::cout << r.first.get_id().id << ": construct value_node: type=" << (int)type
                       << std::endl;
@@ -76,15 +77,16 @@ namespace triedent
           key_view                      key,
           std::uint32_t                 key_offset,
           value_view                    val,
-          node_type                     type)
+          node_type                     type,
+          placement                     where = placement::hot)
       {
          if (id && type == node_type::roots)
          {
-            return clone_roots(a, session, id, key, key_offset, val, type);
+            return clone_roots(a, session, id, key, key_offset, val, type, where);
          }
          else
          {
-            return clone_bytes(a, session, id, key, key_offset, val, type);
+            return clone_bytes(a, session, id, key, key_offset, val, type, where);
          }
       }
 
@@ -95,14 +97,15 @@ namespace triedent
           key_view                      key,
           std::uint32_t                 key_offset,
           value_view                    val,
-          node_type                     type)
+          node_type                     type,
+          placement                     where)
       {
          if (key_offset != std::uint32_t(-1))
             key = key.substr(key_offset);
          assert(val.size() < 0xffffff - key.size() - sizeof(value_node));
          uint32_t alloc_size = sizeof(value_node) + key.size() + val.size();
          // alloc invalidates key and val
-         auto r = a.alloc(session, alloc_size, type);
+         auto r = a.alloc(session, alloc_size, type, where);
          if (id)
          {
             auto ptr = get(a, session, id);
@@ -124,7 +127,8 @@ namespace triedent
           key_view                      key,
           std::uint32_t                 key_offset,
           value_view                    val,
-          node_type                     type)
+          node_type                     type,
+          placement                     where)
       {
          const std::size_t value_size = val.size();
          if (key_offset != std::uint32_t(-1))
@@ -139,7 +143,7 @@ namespace triedent
          {
             roots[i] = bump_refcount_or_copy(a, session, roots[i]);
          }
-         auto r = a.alloc(session, alloc_size, type);
+         auto r = a.alloc(session, alloc_size, type, where);
          {
             if (key_offset != std::uint32_t(-1))
             {
@@ -183,8 +187,11 @@ namespace triedent
       inline void             set_value(object_id i) { _value = i; }
 
       inline uint32_t num_children() const { return num_branches() + (_value.id != 0); }
-      inline uint32_t num_branches() const { return std::popcount(_present_bits); }
-      inline uint64_t branches() const { return _present_bits; }
+      inline uint32_t num_branches() const
+      {
+         return is_packed() ? _num_packed : std::popcount(_present_bits);
+      }
+      inline uint64_t branches() const;
 
       template <typename... Ts>
       inline static uint64_t branches(Ts... bit_num)
@@ -204,29 +211,65 @@ namespace triedent
           key_view                      key,
           std::uint32_t                 key_offset,
           object_id                     value,
-          std::uint64_t                 branches);
+          std::uint64_t                 branches,
+          placement                     where = placement::hot);
 
       inline static std::pair<location_lock, inner_node*> make(
           cache_allocator&              a,
           std::unique_lock<gc_session>& session,
           key_view                      prefix,
           object_id                     val,
-          uint64_t                      branches);
+          uint64_t                      branches,
+          placement                     where = placement::hot);
 
-      inline bool has_branch(uint32_t b) const { return _present_bits & (1ull << b); }
+      inline bool has_branch(uint32_t b) const;
 
       inline key_view key() const { return key_view(key_ptr(), key_size()); }
 
-      inline int32_t     branch_index(uint32_t branch) const;
-      object_id*         children() { return reinterpret_cast<object_id*>(this + 1); }
-      const object_id*   children() const { return reinterpret_cast<const object_id*>(this + 1); }
+      inline int32_t   branch_index(uint32_t branch) const;
+      object_id*       children() { return reinterpret_cast<object_id*>((char*)this + header_size()); }
+      const object_id* children() const
+      {
+         return reinterpret_cast<const object_id*>((const char*)this + header_size());
+      }
       inline char*       key_ptr() { return reinterpret_cast<char*>(children() + num_branches()); }
       inline const char* key_ptr() const
       {
          return reinterpret_cast<const char*>(children() + num_branches());
       }
 
+      // The number of bytes needed for a node with the given prefix and branches
+      static uint32_t alloc_size(std::size_t prefix_size, uint64_t branches)
+      {
+         auto n = std::popcount(branches);
+         return header_size(n) + prefix_size + n * sizeof(object_id);
+      }
+
      private:
+      // Nodes with at most max_packed branches store the branch numbers as
+      // one byte each in place of _present_bits. Most inner nodes below the
+      // top few levels of a large tree have only a few branches.
+      static constexpr uint32_t max_packed = 4;
+      static constexpr uint8_t  packed_flag = 1;
+
+      bool     is_packed() const { return _flags & packed_flag; }
+      uint8_t* packed_branches() { return reinterpret_cast<uint8_t*>(&_present_bits); }
+      const uint8_t* packed_branches() const
+      {
+         return reinterpret_cast<const uint8_t*>(&_present_bits);
+      }
+      static uint32_t header_size(uint32_t num_branches)
+      {
+         return num_branches <= max_packed ? sizeof(inner_node) - sizeof(uint64_t) + num_branches
+                                           : sizeof(inner_node);
+      }
+      uint32_t header_size() const
+      {
+         return is_packed() ? sizeof(inner_node) - sizeof(uint64_t) + _num_packed
+                            : sizeof(inner_node);
+      }
+      void set_branches(uint64_t branches);
+
       static inner_node* get(cache_allocator& a, session_lock_ref<> session, object_id id)
       {
          auto [ptr, type, ref] = a.get_cache<false>(session, id);
@@ -240,10 +283,13 @@ namespace triedent
       inner_node(object_id id, key_view prefix, object_id val, uint64_t branches);
 
       uint8_t   _prefix_length = 0;  // mirrors value nodes to signal type and prefix length
-      uint8_t   _reserved_a    = 0;  // future use
-      uint8_t   _reserved_b    = 0;  // future use
+      uint8_t   _flags         = 0;  // packed_flag; 0 in nodes written before it existed
+      uint8_t   _num_packed    = 0;  // number of branches if packed
       object_id _value;              // this is 5 bytes
-      uint64_t  _present_bits = 0;   // keep this 8 byte aligned for popcount instructions
+      // keep this 8 byte aligned for popcount instructions. If packed, this
+      // holds the branch numbers instead and is truncated to _num_packed bytes,
+      // so it MUST NOT have a default initializer.
+      uint64_t _present_bits;
    } __attribute__((packed));
    static_assert(sizeof(inner_node) == 3 + 5 + 8, "unexpected padding");
 
@@ -255,21 +301,22 @@ namespace triedent
        key_view                      key,
        std::uint32_t                 key_offset,
        object_id                     value,
-       std::uint64_t                 branches)
+       std::uint64_t                 branches,
+       placement                     where)
    {
       if (key_offset != std::uint32_t(-1))
          key = key.substr(key_offset);
       const std::size_t n          = std::popcount(branches);
-      uint32_t          alloc_size = sizeof(inner_node) + key.size() + n * sizeof(object_id);
+      uint32_t          alloc_size = inner_node::alloc_size(key.size(), branches);
       object_id         children[n + 1];
-      if (in->_present_bits == branches)
+      if (in->branches() == branches)
       {
          std::memcpy(&children[0], in->children(), sizeof(children));
       }
       else
       {
          auto       remaining_branches = branches;
-         auto       in_branches        = in->_present_bits;
+         auto       in_branches        = in->branches();
          object_id* child_iter         = children;
          while (remaining_branches)
          {
@@ -286,7 +333,7 @@ namespace triedent
       {
          children[i] = bump_refcount_or_copy(a, session, children[i]);
       }
-      auto p = a.alloc(session, alloc_size, node_type::inner);
+      auto p = a.alloc(session, alloc_size, node_type::inner, where);
       if (key_offset != std::uint32_t(-1))
       {
          in  = get(a, session, id);
@@ -305,11 +352,10 @@ namespace triedent
        std::unique_lock<gc_session>& session,
        key_view                      prefix,
        object_id                     val,
-       uint64_t                      branches)
+       uint64_t                      branches,
+       placement                     where)
    {
-      uint32_t alloc_size =
-          sizeof(inner_node) + prefix.size() + std::popcount(branches) * sizeof(object_id);
-      auto p  = a.alloc(session, alloc_size, node_type::inner);
+      auto p  = a.alloc(session, alloc_size(prefix.size(), branches), node_type::inner, where);
       auto id = p.first.get_id();
       if constexpr (debug_nodes)
          std::cout << id.id << ": construct inner_node" << std::endl;
@@ -318,12 +364,9 @@ namespace triedent
    }
 
    inline inner_node::inner_node(object_id id, key_view prefix, object_id val, uint64_t branches)
-       : _prefix_length(prefix.size()),
-         _reserved_a(0),
-         _reserved_b(0),
-         _value(val),
-         _present_bits(branches)
+       : _prefix_length(prefix.size()), _value(val)
    {
+      set_branches(branches);
       if constexpr (debug_nodes)
          std::cout << id.id << ": inner_node(): value=" << val.id << std::endl;
       std::memset(children(), 0, sizeof(object_id) * num_branches());
@@ -337,12 +380,9 @@ namespace triedent
                                  object_id  val,
                                  uint64_t   branches,
                                  object_id* new_children)
-       : _prefix_length(prefix.size()),
-         _reserved_a(0),
-         _reserved_b(0),
-         _value(val),
-         _present_bits(branches)
+       : _prefix_length(prefix.size()), _value(val)
    {
+      set_branches(branches);
       if constexpr (debug_nodes)
          std::cout << id.id << ": inner_node(): value=" << val.id << std::endl;
       std::memcpy(children(), new_children, num_branches() * sizeof(object_id));
@@ -351,22 +391,72 @@ namespace triedent
       //assert(not is_value_node());
    }
 
+   inline void inner_node::set_branches(uint64_t branches)
+   {
+      uint32_t n = std::popcount(branches);
+      if (n <= max_packed)
+      {
+         _flags      = packed_flag;
+         _num_packed = n;
+         auto* pos   = packed_branches();
+         for (; branches; branches &= branches - 1)
+            *pos++ = std::countr_zero(branches);
+      }
+      else
+      {
+         _flags        = 0;
+         _num_packed   = 0;
+         _present_bits = branches;
+      }
+   }
+
+   inline uint64_t inner_node::branches() const
+   {
+      if (!is_packed())
+         return _present_bits;
+      uint64_t result = 0;
+      for (auto b : std::span{packed_branches(), _num_packed})
+         result |= 1ull << b;
+      return result;
+   }
+
    inline object_id& inner_node::branch(uint8_t b)
    {
-      assert(branch_index(b) >= 0);
-      if (branch_index(b) < 0) [[unlikely]]
+      auto index = branch_index(b);
+      assert(index >= 0);
+      if (index < 0) [[unlikely]]
          throw std::runtime_error("branch(b) <= 0, b: " + std::to_string(int(b)));
-      return reinterpret_cast<object_id*>((char*)this + sizeof(inner_node))[branch_index(b)];
+      return children()[index];
    }
    inline const object_id& inner_node::branch(uint8_t b) const
    {
       return const_cast<inner_node*>(this)->branch(b);
    }
 
+   // Lookups test packed branches directly, because building the mask
+   // would cost more than scanning at most max_packed bytes.
+   inline bool inner_node::has_branch(uint32_t b) const
+   {
+      if (!is_packed())
+         return _present_bits & (1ull << b);
+      for (auto pb : std::span{packed_branches(), _num_packed})
+         if (pb == b)
+            return true;
+      return false;
+   }
+
    // @return num_children if not found
    inline int32_t inner_node::branch_index(uint32_t branch) const
    {
       assert(branch < 64);
+      if (is_packed())
+      {
+         // The packed branches are sorted
+         int32_t result = -1;
+         for (auto pb : std::span{packed_branches(), _num_packed})
+            result += pb <= branch;
+         return result;
+      }
       const uint32_t maskbits = branch % 64;
       const uint64_t mask     = -1ull >> (63 - maskbits);
 
@@ -377,14 +467,14 @@ namespace triedent
    inline uint8_t inner_node::lower_bound(uint8_t b) const
    {
       const uint64_t mask = (-1ull << (b & 63));
-      return b >= 64 ? 64 : std::countr_zero(_present_bits & mask);
+      return b >= 64 ? 64 : std::countr_zero(branches() & mask);
    }
 
    // last branch <= b
    inline int8_t inner_node::reverse_lower_bound(uint8_t b) const
    {
       const uint64_t mask = b == 63 ? -1ull : ~(-1ull << ((b + 1) & 63));
-      return 63 - std::countl_zero(_present_bits & mask);
+      return 63 - std::countl_zero(branches() & mask);
    }
 
    // @return the first branch > b, if b == 63 then
@@ -392,7 +482,7 @@ namespace triedent
    inline uint8_t inner_node::upper_bound(uint8_t b) const
    {
       const uint64_t mask = (-1ull << ((b + 1) & 63));
-      return b >= 63 ? 64 : std::countr_zero(_present_bits & mask);
+      return b >= 63 ? 64 : std::countr_zero(branches() & mask);
    }
 
    inline void release_node(session_lock_ref<> l, cache_allocator& ra, object_id obj)
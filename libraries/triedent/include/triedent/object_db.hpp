@@ -269,7 +269,7 @@ namespace triedent
 
       auto _header = header();
 
-      if (_header->magic != file_magic)
+      if (!check_file_magic(_header->magic, mode == access_mode::read_write))
          throw std::runtime_error("Not a triedent file: " + idfile.native());
       if ((_header->flags & file_type_mask) != file_type_index)
          throw std::runtime_error("Not a triedent obj_ids file: " + idfile.native());
@@ -338,15 +338,20 @@ namespace triedent
       if (id.id > h->max_allocated.id) [[unlikely]]
          throw std::runtime_error("invalid object id, outside allocated range");
 
-      auto& obj       = h->objects[id.id];
-      auto  ref_count = ref(id);
-      if (ref_count == 0)
-         throw std::runtime_error("reference to deleted object found");
-      if (ref_count == ref_count_mask)
-         throw std::runtime_error("too many references to object id");
-
-      // This can set the reference count to ref_count_max, which is otherwise illegal
-      obj.fetch_add(1);
+      // The walk may run on several threads, so the check and the
+      // increment must be a single atomic operation.
+      auto&    obj = h->objects[id.id];
+      uint64_t val = obj.load();
+      uint64_t ref_count;
+      do
+      {
+         ref_count = val & ref_count_mask;
+         if (ref_count == 0)
+            throw std::runtime_error("reference to deleted object found");
+         if (ref_count == ref_count_mask)
+            throw std::runtime_error("too many references to object id");
+         // This can set the reference count to ref_count_max, which is otherwise illegal
+      } while (!obj.compare_exchange_weak(val, val + 1));
       return ref_count == 1;
    }
 
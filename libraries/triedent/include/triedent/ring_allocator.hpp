@@ -5,7 +5,9 @@
 #include <triedent/mapping.hpp>
 #include <triedent/object_fwd.hpp>
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <mutex>
@@ -96,11 +98,17 @@ namespace triedent
       // including padding.
       std::shared_ptr<void> swap(std::uint64_t target, auto&& move_object);
 
-      // Blocks until potential_free_bytes becomes less than min_swap or done is true
+      // Blocks until potential_free_bytes becomes less than min_swap, an
+      // allocation is waiting for memory, or done is true.
       // This MUST NOT be called concurrently with itself or swap.
       void wait_swap(std::uint64_t min_swap, std::atomic<bool>* done);
 
-      // Wakes up a thread that is blocked in wait_swap
+      // Blocks until an object of size bytes can be allocated or done is true.
+      // This MUST NOT be called while holding a session lock, because the
+      // memory it waits for is released by the gc_queue.
+      void wait_free(std::size_t size, std::atomic<bool>* done);
+
+      // Wakes up threads that are blocked in wait_swap or wait_free
       void notify_swap();
 
       // Blocking overload of allocate.
@@ -118,6 +126,26 @@ namespace triedent
       template <typename F>
       void* try_allocate(session_lock_ref<>, object_id id, std::size_t size, F&& init);
 
+      // Holds the allocation lock across a run of non-blocking allocations,
+      // so that a swap worker moving many objects into this ring takes the
+      // lock once per run instead of once per object. The lock is released
+      // periodically to bound the time other threads wait for it.
+      //
+      // A batch MUST NOT be held while blocking on anything else.
+      class batch
+      {
+        public:
+         explicit batch(ring_allocator& self) : _self(self), _lock(self._free_mutex) {}
+         template <typename F>
+         void* try_allocate(session_lock_ref<>, object_id id, std::size_t size, F&& init);
+
+        private:
+         static constexpr std::uint32_t max_run = 256;
+         ring_allocator&                _self;
+         std::unique_lock<std::mutex>   _lock;
+         std::uint32_t                  _count = 0;
+      };
+
       // \pre offset is an offset that was previously returned by allocate.
       //
       // This should NOT be used internally to ring_allocator.
@@ -163,6 +191,35 @@ namespace triedent
          return result->data();
       }
       // \pre _free_mutex must be held
+      template <typename F>
+      void* try_allocate_locked(object_id id, std::size_t size, F&& init)
+      {
+         uint64_t used_size = alloc_size(size);
+         if (!check_contiguous_free_space(used_size))
+            return nullptr;
+         void* result = allocate_impl(size, used_size, id, init);
+         // Wake the worker that swaps this ring
+         if (potential_free_bytes_unlocked() < _free_min)
+            _swap_cond.notify_one();
+         return result;
+      }
+      // Keeps the swap thread running for as long as an allocation is waiting
+      // \pre _free_mutex must be held
+      void start_stall()
+      {
+         ++_stalled;
+         _swap_cond.notify_one();
+      }
+      // \pre _free_mutex must be held
+      void end_stall(std::chrono::steady_clock::time_point start)
+      {
+         --_stalled;
+         auto d = std::chrono::steady_clock::now() - start;
+         _stall_count.fetch_add(1, std::memory_order_relaxed);
+         _stall_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count(),
+                             std::memory_order_relaxed);
+      }
+      // \pre _free_mutex must be held
       // \post if the result is true, then there is at least used_size
       // contiguous free space starting at _alloc_p.
       bool check_contiguous_free_space(std::uint64_t used_size)
@@ -246,6 +303,10 @@ namespace triedent
       std::uint64_t           _end_free_p;
       std::condition_variable _swap_cond;
       std::uint64_t           _free_min;
+      std::uint32_t           _stalled = 0;
+
+      std::atomic<std::uint64_t> _stall_count{0};
+      std::atomic<std::uint64_t> _stall_ns{0};
 
       std::uint8_t                   _level;
       static constexpr std::uint64_t _mask = ~std::uint64_t{0} >> 1;
@@ -281,7 +342,13 @@ namespace triedent
       std::unique_lock l{_free_mutex};
       {
          relocker rl{session};
-         _free_cond.wait(l, [&] { return check_contiguous_free_space(used_size); });
+         if (!check_contiguous_free_space(used_size))
+         {
+            auto start = std::chrono::steady_clock::now();
+            start_stall();
+            _free_cond.wait(l, [&] { return check_contiguous_free_space(used_size); });
+            end_stall(start);
+         }
       }
 
       void* result = allocate_impl(size, used_size, id, init);
@@ -295,17 +362,23 @@ namespace triedent
    template <typename F>
    void* ring_allocator::try_allocate(session_lock_ref<>, object_id id, std::size_t size, F&& init)
    {
-      uint64_t used_size = alloc_size(size);
-
       std::unique_lock l{_free_mutex};
-      if (check_contiguous_free_space(used_size))
-      {
-         return allocate_impl(size, used_size, id, init);
-      }
-      else
+      return try_allocate_locked(id, size, init);
+   }
+
+   template <typename F>
+   void* ring_allocator::batch::try_allocate(session_lock_ref<>,
+                                             object_id   id,
+                                             std::size_t size,
+                                             F&&         init)
+   {
+      if (++_count == max_run)
       {
-         return nullptr;
+         _count = 0;
+         _lock.unlock();
+         _lock.lock();
       }
+      return _self.try_allocate_locked(id, size, init);
    }
 
    template <typename F>
@@ -331,7 +404,9 @@ namespace triedent
          }
          swap_p = next(swap_p, ptr);
       }
-      result.used_bytes = result.total_bytes - result.free_bytes;
+      result.used_bytes  = result.total_bytes - result.free_bytes;
+      result.stall_count = _stall_count.load(std::memory_order_relaxed);
+      result.stall_ns    = _stall_ns.load(std::memory_order_relaxed);
       return result;
    }
 
@@ -1,5 +1,6 @@
 #include <triedent/cache_allocator.hpp>
 
+#include <algorithm>
 #include <cstring>
 
 namespace triedent
@@ -13,17 +14,36 @@ namespace triedent
          _levels{ring_allocator{dir / "hot", cfg.hot_bytes, hot_cache, mode, true},
                  ring_allocator{dir / "warm", cfg.warm_bytes, warm_cache, mode, true},
                  ring_allocator{dir / "cool", cfg.cool_bytes, cool_cache, mode, true}},
-         _cold{_gc, _obj_ids, dir / "cold", mode, cfg.cold_bytes}
+         _cold{_gc, _obj_ids, dir / "cold", mode, cfg.cold_bytes},
+         _admission{cfg.admission},
+         _admission_threshold{cfg.admission_threshold},
+         // Roughly one counter per object that fits in hot
+         _sketch{cfg.admission == hot_admission::frequency
+                     ? std::clamp(cfg.hot_bytes / 64, std::uint64_t{1} << 12, std::uint64_t{1} << 26)
+                     : 0}
    {
       if (mode == access_mode::read_write)
       {
-         _swap_thread = std::thread(
-             [this]()
-             {
-                thread_name("swap");
-                pthread_setname_np(pthread_self(), "swap");
-                swap_loop();
-             });
+         auto start_swap = [this](const char* name, auto&& f)
+         {
+            _swap_threads.emplace_back(
+                [name, f]()
+                {
+                   thread_name(name);
+                   pthread_setname_np(pthread_self(), name);
+                   f();
+                });
+         };
+         if (cfg.swap == swap_mode::single)
+         {
+            start_swap("swap", [this] { swap_loop(); });
+         }
+         else
+         {
+            start_swap("swap-hot", [this] { swap_worker(hot(), warm()); });
+            start_swap("swap-warm", [this] { swap_worker(warm(), cool()); });
+            start_swap("swap-cool", [this] { swap_worker(cool(), cold()); });
+         }
          _gc_thread = std::thread{[this]
                                   {
                                      pthread_setname_np(pthread_self(), "swap");
@@ -35,10 +55,11 @@ namespace triedent
    cache_allocator::~cache_allocator()
    {
       _done.store(true);
-      hot().notify_swap();
+      for (auto& level : _levels)
+         level.notify_swap();
       _gc.notify_run();
-      if (_swap_thread.joinable())
-         _swap_thread.join();
+      for (auto& t : _swap_threads)
+         t.join();
       _cold.stop();
       if (_gc_thread.joinable())
          _gc_thread.join();
@@ -53,15 +74,46 @@ namespace triedent
       }
    }
 
-   bool cache_allocator::swap(gc_session& session)
+   namespace
+   {
+      constexpr std::uint64_t swap_target     = 1024 * 1024 * 40ull;
+      constexpr std::uint64_t swap_min_target = 1024 * 1024 * 33ull;
+   }  // namespace
+
+   // Worker for a single source level. Each ring is only swapped by its own
+   // worker, which keeps the single-swapper requirement of ring_allocator.
+   void cache_allocator::swap_worker(ring_allocator& from, auto& to)
+   {
+      gc_session session{_gc};
+      // Small levels could never reach swap_min_target
+      auto min_target = std::min(swap_min_target, from.capacity() / 2);
+      while (true)
+      {
+         from.wait_swap(min_target, &_done);
+         if (_done.load())
+            return;
+         auto result = swap_level(session, from, to);
+         if (!result.did_work && result.blocked)
+         {
+            // The next level is full. Waiting here keeps its worker
+            // running until the object fits.
+            if constexpr (std::is_same_v<std::remove_cvref_t<decltype(to)>, ring_allocator>)
+               to.wait_free(result.blocked, &_done);
+         }
+         _gc.poll();
+      }
+   }
+
+   // Moves up to swap_target bytes of the oldest objects in from to to
+   cache_allocator::swap_result cache_allocator::swap_level(gc_session&     session,
+                                                            ring_allocator& from,
+                                                            auto&           to)
    {
-      constexpr uint64_t      target     = 1024 * 1024 * 40ull;
-      constexpr std::uint64_t min_target = 1024 * 1024 * 33ull;
-      bool                    did_work   = false;
-      auto                    do_swap    = [&](auto& from, auto& to)
+      swap_result result;
+      std::unique_lock sl{session};
+      auto             move_run = [&](auto&& try_allocate)
       {
-         std::unique_lock sl{session};
-         auto             move_one = [&](object_header* o, object_location loc)
+         auto move_one = [&](object_header* o, object_location loc)
          {
             // When a block is initialized, id and o point to
             // each other. The block is valid as long as this
@@ -74,32 +126,54 @@ namespace triedent
             //
             if (auto lock = _obj_ids.lock({.id = o->id}, loc))
             {
-               void* p = to.try_allocate(sl, lock.get_id(), o->size,
-                                         [&](void* ptr, object_location newloc)
-                                         {
-                                            std::memcpy(ptr, o->data(), o->size);
-                                            _obj_ids.compare_and_move(lock, loc, newloc);
-                                         });
+               void* p = try_allocate(lock.get_id(), o->size,
+                                      [&](void* ptr, object_location newloc)
+                                      {
+                                         std::memcpy(ptr, o->data(), o->size);
+                                         _obj_ids.compare_and_move(lock, loc, newloc);
+                                      });
+               if (!p)
+                  result.blocked = o->size;
                return p != nullptr;
             }
             return true;
          };
-         if (auto p = from.swap(std::min(target, from.capacity()), move_one))
-         {
-            _gc.push(p);
-            did_work = true;
-         }
+         return from.swap(std::min(swap_target, from.capacity()), move_one);
       };
-      hot().wait_swap(min_target, &_done);
+      std::shared_ptr<void> p;
+      if constexpr (std::is_same_v<std::remove_cvref_t<decltype(to)>, ring_allocator>)
+      {
+         // Moves between rings take the destination's lock once per run
+         ring_allocator::batch b{to};
+         p = move_run([&](object_id id, std::uint32_t size, auto&& init)
+                      { return b.try_allocate(sl, id, size, init); });
+      }
+      else
+      {
+         p = move_run([&](object_id id, std::uint32_t size, auto&& init)
+                      { return to.try_allocate(sl, id, size, init); });
+      }
+      sl.unlock();
+      if (p)
+      {
+         _gc.push(p);
+         result.did_work = true;
+      }
+      return result;
+   }
+
+   bool cache_allocator::swap(gc_session& session)
+   {
+      hot().wait_swap(swap_min_target, &_done);
       if (_done.load())
          return false;
-      do_swap(cool(), cold());
+      swap_level(session, cool(), cold());
       if (_done.load())
          return false;
-      do_swap(warm(), cool());
+      swap_level(session, warm(), cool());
       if (_done.load())
          return false;
-      do_swap(hot(), warm());
+      swap_level(session, hot(), warm());
       _gc.poll();
       return true;
    }
@@ -124,6 +198,14 @@ namespace triedent
       return result;
    }
 
+   cache_allocator::read_stats& cache_allocator::local_read_stats()
+   {
+      static std::atomic<std::size_t> next_thread{0};
+      thread_local std::size_t        index =
+          next_thread.fetch_add(1, std::memory_order_relaxed) % num_read_stats;
+      return _read_stats[index];
+   }
+
    namespace
    {
       std::string make_size(std::uint64_t val)
@@ -154,6 +236,8 @@ namespace triedent
          os << "Free: " << make_size(stats.free_bytes) << std::endl;
          os << "Capacity: " << make_size(stats.total_bytes) << std::endl;
          os << "Available: " << make_size(stats.available_bytes) << std::endl;
+         os << "Stalls: " << stats.stall_count << " ("
+            << stats.stall_ns / 1000000 << " ms)" << std::endl;
       };
       os << "File: hot\n";
       print_level(hot());
@@ -165,6 +249,18 @@ namespace triedent
       print_level(cold());
       os << "File: obj_ids\n";
       _obj_ids.print_stats(os);
+
+      std::uint64_t hot_reads = 0, cold_reads = 0, promoted = 0;
+      for (const auto& stats : _read_stats)
+      {
+         hot_reads += stats.hot_reads.load(std::memory_order_relaxed);
+         cold_reads += stats.cold_reads.load(std::memory_order_relaxed);
+         promoted += stats.promoted.load(std::memory_order_relaxed);
+      }
+      os << "Reads: " << hot_reads + cold_reads << std::endl;
+      if (hot_reads + cold_reads)
+         os << "Hot hit rate: " << 100.0 * hot_reads / (hot_reads + cold_reads) << "%" << std::endl;
+      os << "Promoted to hot: " << promoted << std::endl;
    }
 
 }  // namespace triedent
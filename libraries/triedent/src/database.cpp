@@ -23,7 +23,7 @@ namespace triedent
 
       _dbm = reinterpret_cast<database_memory*>(_file.data());
 
-      if (_dbm->magic != file_magic)
+      if (!check_file_magic(_dbm->magic, mode == access_mode::read_write))
          throw std::runtime_error("Not a triedent file: " + (dir / "db").native());
       if ((_dbm->flags & file_type_mask) != file_type_database_root)
          throw std::runtime_error("Not a triedent db file: " + (dir / "db").native());
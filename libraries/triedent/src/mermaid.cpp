@@ -16,6 +16,7 @@ int main(int argc, char** argv)
       uint32_t    warm_page_c = 33;
       uint32_t    cool_page_c = 35;
       uint32_t    cold_page_c = 35;
+      uint32_t    gc_threads  = 1;
       std::string db_dir;
 
       po::options_description desc("Allowed options");
@@ -25,6 +26,8 @@ int main(int argc, char** argv)
       opt("status", "print status of the database");
       opt("validate", "count the number of keys in database");
       opt("gc", "free any space caused by dangling ref counts");
+      opt("gc-threads", po::value<uint32_t>(&gc_threads)->default_value(gc_threads),
+          "the number of threads used by --gc to walk the tree");
       opt("create", "creates an empty database with the give parameters");
       opt("data-dir", po::value<std::string>(&db_dir)->default_value("./big.dir"),
           "the folder that contains the database");
@@ -79,7 +82,9 @@ int main(int argc, char** argv)
          auto db = std::make_shared<database>(db_dir.c_str(), triedent::database::read_write, true);
          auto s  = db->start_write_session();
          s->start_collect_garbage();
-         s->recursive_retain();
+         s->recursive_retain(gc_threads,
+                             [](std::uint64_t nodes)
+                             { std::cerr << "retained " << nodes << " nodes" << std::endl; });
          s->end_collect_garbage();
       }
    }
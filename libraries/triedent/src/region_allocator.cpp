@@ -30,7 +30,7 @@ namespace triedent
       _h      = &_header->regions[_header->current.load()];
       _base   = _header->base();
 
-      if (_header->magic != file_magic)
+      if (!check_file_magic(_header->magic, mode == access_mode::read_write))
          throw std::runtime_error("Not a triedent file: " + path.native());
       if ((_header->flags & file_type_mask) != file_type_cold)
          throw std::runtime_error("Not a triedent cold data file: " + path.native());
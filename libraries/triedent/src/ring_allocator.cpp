@@ -23,7 +23,7 @@ namespace triedent
       }
       _header = reinterpret_cast<header*>(_file.data());
 
-      if (_header->magic != file_magic)
+      if (!check_file_magic(_header->magic, mode == access_mode::read_write))
          throw std::runtime_error("Not a triedent file: " + path.native());
       if ((_header->flags & file_type_mask) != file_type_data)
          throw std::runtime_error("Not a triedent data file: " + path.native());
@@ -42,16 +42,33 @@ namespace triedent
       std::unique_lock l{_free_mutex};
       _free_min = min_bytes;
       _swap_cond.wait(l,
-                      [&] { return done->load() || potential_free_bytes_unlocked() < min_bytes; });
+                      [&]
+                      {
+                         return done->load() || _stalled ||
+                                potential_free_bytes_unlocked() < min_bytes;
+                      });
       _free_min = 0;
    }
 
+   void ring_allocator::wait_free(std::size_t size, std::atomic<bool>* done)
+   {
+      auto             used_size = alloc_size(size);
+      std::unique_lock l{_free_mutex};
+      if (check_contiguous_free_space(used_size))
+         return;
+      auto start = std::chrono::steady_clock::now();
+      start_stall();
+      _free_cond.wait(l, [&] { return done->load() || check_contiguous_free_space(used_size); });
+      end_stall(start);
+   }
+
    void ring_allocator::notify_swap()
    {
       // The lock here is needed to synchronize-with wait_swap
       // even through no data is accessed while holding the lock.
       std::lock_guard{_free_mutex};
       _swap_cond.notify_all();
+      _free_cond.notify_all();
    }
 
    std::shared_ptr<void> ring_allocator::make_update_free(std::uint64_t bytes)
@@ -1,167 +1,184 @@
-#include <stdlib.h>
-#include <boost/format.hpp>
-#include <fstream>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <random>
+
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
 
 #include <triedent/database.hpp>
 
-uint64_t bswap(uint64_t x)
-{
-   x = (x & 0x00000000FFFFFFFF) << 32 | (x & 0xFFFFFFFF00000000) >> 32;
-   x = (x & 0x0000FFFF0000FFFF) << 16 | (x & 0xFFFF0000FFFF0000) >> 16;
-   x = (x & 0x00FF00FF00FF00FF) << 8 | (x & 0xFF00FF00FF00FF00) >> 8;
-   return x;
-}
-inline std::string to_key(const std::string_view v)
-{
-   std::string s(v.data(), v.size());
-   for (auto& c : s)
-   {
-      c -= 62;
-      c &= 63;
-   }
-   return s;
-}
-inline std::string from_key(const std::string& sv)
-{
-   std::string out;
-   out.reserve(sv.size());
-   for (int i = 0; i < sv.size(); ++i)
-      out += sv[i] + 62;
-   return out;
-}
+// Simulates blocks full of token transfers. Each block starts from the
+// previous block's root, which is kept alive like a revision, so the first
+// write to any path has to clone it. The same transfers are written once
+// with one upsert per key and once with write_session::apply per block.
+// Balances are tracked in memory, so only the writes are timed.
 
-int64_t rand64()
-{
-   return uint64_t(rand()) << 32 | uint64_t(rand());
-}
+using root_t = std::shared_ptr<triedent::root>;
 
-void load_key_values(std::vector<std::string>&  keys,
-                     std::vector<std::string>&  vals,
-                     std::string                words,
-                     std::optional<std::string> from,
-                     std::optional<std::string> to)
+struct bank
 {
-   for (auto c : {words})
+   triedent::write_session& s;
+   std::vector<uint64_t>&   users;
+
+   struct write
    {
-      std::ifstream in(c);
-      std::string   str;
-      while (std::getline(in, str))
+      uint64_t user;
+      int64_t  balance;
+   };
+
+   // Returns the number of milliseconds spent writing
+   double run(root_t   base,
+              int64_t  initial,
+              uint64_t num_blocks,
+              uint64_t block_size,
+              bool     batched,
+              unsigned seed,
+              root_t&  result)
+   {
+      std::mt19937_64                 gen(seed);
+      std::vector<int64_t>            balances(users.size(), initial);
+      std::vector<write>              writes;
+      std::vector<triedent::mutation> mutations;
+      root_t                          prev = base;
+      std::chrono::duration<double>   elapsed{};
+      for (uint64_t b = 0; b < num_blocks; ++b)
       {
-         if (from and str < *from)
-            continue;
-         if (to and str > *to)
-            continue;
-
-         vals.push_back(from_key(to_key(str)));
-         keys.push_back(to_key(str));
+         writes.clear();
+         for (uint64_t i = 0; i < block_size; ++i)
+         {
+            uint64_t from   = gen() % users.size();
+            uint64_t to     = gen() % users.size();
+            int64_t  amount = gen() % 100000;
+            balances[from] -= amount;
+            writes.push_back({from, balances[from]});
+            balances[to] += amount;
+            writes.push_back({to, balances[to]});
+         }
+
+         root_t r     = prev;
+         auto   start = std::chrono::steady_clock::now();
+         if (batched)
+         {
+            mutations.clear();
+            for (auto& w : writes)
+               mutations.push_back({{(char*)&users[w.user], sizeof(uint64_t)},
+                                    std::span<const char>{(char*)&w.balance, sizeof(int64_t)}});
+            s.apply(r, mutations);
+         }
+         else
+         {
+            for (auto& w : writes)
+               s.upsert(r, {(char*)&users[w.user], sizeof(uint64_t)},
+                        {(char*)&w.balance, sizeof(int64_t)});
+         }
+         elapsed += std::chrono::steady_clock::now() - start;
+         prev = std::move(r);
       }
+      result = std::move(prev);
+      return std::chrono::duration<double, std::milli>(elapsed).count();
    }
-}
+};
 
 int main(int argc, char** argv)
 {
-   std::vector<std::string>   keys;
-   std::vector<std::string>   values;
-   std::optional<std::string> from, to;
-
-   if (argc == 1)
+   namespace po            = boost::program_options;
+   uint32_t    hot_page_c  = 30;
+   uint32_t    warm_page_c = 30;
+   uint32_t    cool_page_c = 30;
+   uint32_t    cold_page_c = 32;
+   std::string db_dir;
+   uint64_t    num_users;
+   uint64_t    num_blocks;
+   uint64_t    block_size;
+
+   po::options_description desc("Allowed options");
+   auto                    opt = desc.add_options();
+   opt("help,h", "print this message");
+   opt("reset", "reset the database");
+   opt("data-dir", po::value<std::string>(&db_dir)->default_value("./bank.dir"),
+       "the folder that contains the database");
+   opt("hot-size,H", po::value<uint32_t>(&hot_page_c)->default_value(30),
+       "the power of 2 for the amount of RAM for the hot ring, RAM = 2^(hot_size) bytes");
+   opt("warm-size,w", po::value<uint32_t>(&warm_page_c)->default_value(30),
+       "the power of 2 for the amount of RAM for the warm ring, RAM = 2^(warm_size) bytes");
+   opt("cool-size,c", po::value<uint32_t>(&cool_page_c)->default_value(30),
+       "the power of 2 for the amount of RAM for the cool ring, RAM = 2^(cool_size) bytes");
+   opt("cold-size,C", po::value<uint32_t>(&cold_page_c)->default_value(32),
+       "the power of 2 for the amount of RAM for the cold ring, RAM = 2^(cold_size) bytes");
+   opt("users,u", po::value<uint64_t>(&num_users)->default_value(1000000),
+       "the number of accounts");
+   opt("blocks,b", po::value<uint64_t>(&num_blocks)->default_value(100),
+       "the number of blocks to run in each mode");
+   opt("block-size,n", po::value<uint64_t>(&block_size)->default_value(10000),
+       "the number of transfers in each block");
+
+   po::variables_map vm;
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+
+   if (vm.count("help"))
    {
-      std::cout << "usage: test words.txt [from][to]\n";
-      return 0;
+      std::cerr << desc << "\n";
+      return 1;
    }
-   if (argc > 2)
-      from = std::string(argv[2]);
-   if (argc > 3)
-      to = std::string(argv[3]);
-
-   load_key_values(keys, values, argv[1], from, to);
-   std::cerr << "loaded " << keys.size() << " keys\n";
-
-   uint64_t           total = 2 * 1000 * 1000 * 1000;
-   triedent::database db("bank.dir",
-                         triedent::database::config{.max_objects = (5 * total) / 4,
-                                                    .hot_pages   = 128 * 16 * 1024ull,
-                                                    .cold_pages  = 8 * 1024 * 1024ull},
-                         triedent::database::read_write);
-   db.print_stats();
-
-   srand(0);
-   auto s = db.start_write_session();
-
-   std::vector<uint64_t> users;
-   users.resize(1000 * 1000 * 20);
-   std::cout << " creating " << users.size() << " user names.\n";
-   for (uint32_t i = 0; i < users.size(); ++i)
+   if (vm.count("reset") || !std::filesystem::exists(db_dir))
    {
-      users[i] = rand64() & 0x3f3f3f3f3f3f3f3f;
+      std::cerr << "resetting database\n";
+      std::filesystem::remove_all(db_dir);
+      triedent::database::create(db_dir,
+                                 triedent::database::config{.hot_bytes  = 1ull << hot_page_c,
+                                                            .warm_bytes = 1ull << warm_page_c,
+                                                            .cool_bytes = 1ull << cool_page_c,
+                                                            .cold_bytes = 1ull << cold_page_c});
    }
 
-   bool inserts = 0;
+   auto db = std::make_shared<triedent::database>(db_dir.c_str(), triedent::database::read_write);
+   auto s  = db->start_write_session();
 
-   std::cout << " starting " << total << " random transfers\n";
-   auto lstart = std::chrono::steady_clock::now();
-   auto per    = 1000000ull;
-   for (uint32_t i = 0; i < total; ++i)
+   std::mt19937_64       gen(0);
+   std::vector<uint64_t> users(num_users);
+   for (auto& u : users)
+      u = gen();
+
+   std::cerr << "creating " << users.size() << " accounts\n";
+   root_t  base;
+   int64_t initial = 1000000;
    {
-      uint64_t from     = rand64() % users.size();
-      uint64_t to       = rand64() % users.size();
-      uint64_t amount   = rand64() % 100000;
-      auto     from_b   = s->get(std::string_view((char*)&users[from], sizeof(uint64_t)));
-      auto     to_b     = s->get(std::string_view((char*)&users[to], sizeof(uint64_t)));
-      int64_t  new_from = 0;
-      int64_t  new_to   = 0;
-
-      if (from_b)
-      {
-         if (from_b->size() != sizeof(uint64_t))
-            throw std::runtime_error("expected different size");
-         memcpy(&new_from, from_b->data(), from_b->size());
-         //   std::cout << "found user from: " << from <<" " << users[from] <<"\n";
-      }
-      else
-      {
-         //  std::cout << "create user from: " << from <<"  " << users[from]<<"\n";
-      }
-      if (to_b)
-      {
-         if (to_b->size() != sizeof(uint64_t))
-            throw std::runtime_error("expected different size");
-         memcpy(&new_to, to_b->data(), to_b->size());
-         //  std::cout << "found user to: " << to <<"  " << users[to]<<"\n";
-      }
-      else
-      {
-         //  std::cout << "create user to: " << to <<"  " << users[to]<<"\n";
-      }
-      new_from -= amount;
-      new_to += amount;
-      inserts += s->upsert(std::string_view((char*)&users[from], sizeof(uint64_t)),
-                           std::string_view((char*)&new_from, sizeof(new_from)));
-      inserts += s->upsert(std::string_view((char*)&users[to], sizeof(uint64_t)),
-                           std::string_view((char*)&new_to, sizeof(new_to)));
-
-      if (i % 1000 == 999)
-         db.swap();
-      if (i % per == 1)
-      {
-         auto end   = std::chrono::steady_clock::now();
-         auto delta = end - lstart;
-         lstart     = end;
-         std::cerr << "progress " << 100 * double(i) / total << " %  "
-                   << std::chrono::duration<double, std::milli>(delta).count() << " ms per 1m\n";
-         std::cout << "total inserts: " << inserts << "  total updates: " << i - inserts << "\n";
-         std::cout << per / (std::chrono::duration<double, std::milli>(delta).count() / 1000)
-                   << " transfers/sec   iteration: " << i << " \n";
-      }
-      if (i % (5 * per) == 1)
+      triedent::write_batch batch;
+      for (auto& u : users)
+         batch.upsert({(char*)&u, sizeof(u)}, {(char*)&initial, sizeof(initial)});
+      s->apply(base, batch);
+   }
+
+   bank   b{*s, users};
+   root_t upsert_result, batch_result;
+   std::cerr << "running " << num_blocks << " blocks of " << block_size << " transfers\n";
+   auto upsert_ms = b.run(base, initial, num_blocks, block_size, false, 1, upsert_result);
+   auto batch_ms  = b.run(base, initial, num_blocks, block_size, true, 1, batch_result);
+
+   auto total = double(num_blocks * block_size * 2);
+   std::cerr << std::fixed << std::setprecision(0);
+   std::cerr << "upsert: " << std::setw(12) << total / (upsert_ms / 1000) << " writes/sec\n";
+   std::cerr << "batch:  " << std::setw(12) << total / (batch_ms / 1000) << " writes/sec\n";
+   std::cerr << std::setprecision(2) << "speedup: " << upsert_ms / batch_ms << "x\n";
+
+   // Both modes must produce the same state
+   std::vector<char> a, c;
+   for (auto& u : users)
+   {
+      std::string_view key{(char*)&u, sizeof(u)};
+      if (s->get(upsert_result, key, &a, nullptr) != s->get(batch_result, key, &c, nullptr) ||
+          a != c)
       {
-         db.print_stats();
+         std::cerr << "state mismatch\n";
+         return 1;
       }
    }
 
-   //   s.clear();
-   //   db.print_stats();
-
+   db->print_stats(std::cerr);
+   std::cerr << "\n";
    return 0;
 }
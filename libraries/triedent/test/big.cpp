@@ -149,10 +149,9 @@ int main(int argc, char** argv)
             while (r.load(std::memory_order_relaxed) == v)
             {
                uint64_t h = (uint64_t(gen()) << 32) | gen();
-               // TODO
-               // auto     itr = rs->lower_bound(rr, std::string_view((char*)&h, sizeof(h)));
-               // if (itr.valid())
-               //    ++total_lookups[c].total_lookups;
+               if (rs->get_greater_equal(rr, std::string_view((char*)&h, sizeof(h)), nullptr,
+                                         nullptr, nullptr))
+                  ++total_lookups[c].total_lookups;
                if (done.load(std::memory_order_relaxed))
                   break;
             }
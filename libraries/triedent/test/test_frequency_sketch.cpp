@@ -0,0 +1,59 @@
+#include <triedent/frequency_sketch.hpp>
+
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using namespace triedent;
+
+TEST_CASE("frequency_sketch")
+{
+   frequency_sketch sketch{1 << 12};
+
+   CHECK(sketch.estimate(1) == 0);
+   CHECK(sketch.increment(1) == 1);
+   CHECK(sketch.increment(1) == 2);
+   CHECK(sketch.estimate(1) == 2);
+   CHECK(sketch.estimate(2) == 0);
+
+   // Counters saturate
+   for (int i = 0; i < 20; ++i)
+      sketch.increment(3);
+   CHECK(sketch.estimate(3) == frequency_sketch::max_count);
+
+   // Keys that are seen once stay below keys that are seen repeatedly, and
+   // old counts are halved after (1 << 11) increments.
+   for (std::uint64_t i = 100; i < 100 + (1 << 11); ++i)
+      sketch.increment(i);
+   CHECK(sketch.estimate(3) < frequency_sketch::max_count);
+   CHECK(sketch.estimate(3) >= frequency_sketch::max_count / 2);
+   std::uint64_t high = 0;
+   for (std::uint64_t i = 100; i < 100 + (1 << 11); ++i)
+      high += sketch.estimate(i) > 2;
+   CHECK(high < 100);
+}
+
+TEST_CASE("frequency_sketch threads")
+{
+   frequency_sketch sketch{1 << 16};
+
+   std::vector<std::jthread> threads;
+   for (int i = 0; i < 4; ++i)
+   {
+      threads.emplace_back(
+          [&]
+          {
+             for (int j = 0; j < 10; ++j)
+                sketch.increment(42);
+          });
+   }
+   threads.clear();
+   CHECK(sketch.estimate(42) == frequency_sketch::max_count);
+
+   frequency_sketch small{1 << 16};
+   for (int i = 0; i < 4; ++i)
+      threads.emplace_back([&] { small.increment(7); });
+   threads.clear();
+   CHECK(small.estimate(7) == 4);
+}
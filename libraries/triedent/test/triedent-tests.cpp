@@ -2,7 +2,10 @@
 
 #include "temp_directory.hpp"
 
+#include <fstream>
+#include <map>
 #include <random>
+#include <thread>
 
 template <typename S, typename T>
 S& operator<<(S& stream, const std::optional<T>& obj)
@@ -132,6 +135,27 @@ TEST_CASE("insert")
    }
 }
 
+TEST_CASE("get view")
+{
+   auto db      = createDb();
+   auto session = db->start_write_session();
+   auto root    = session->get_top_root();
+   session->upsert(root, "abc"s, "v0"s);
+   std::string big(1000, 'x');
+   session->upsert(root, "abcd"s, big);
+   auto read = db->start_read_session();
+   {
+      auto l = read->lock_cache();
+      CHECK(read->get_view(l, root, "abc"s) == osv("v0"));
+      CHECK(read->get_view(l, root, "abcd"s) == osv(big));
+      CHECK(!read->get_view(l, root, "ab"s));
+      CHECK(!read->get_view(l, root, "abce"s));
+   }
+   std::shared_ptr<triedent::root> empty;
+   auto                            l = session->lock_cache();
+   CHECK(!session->get_view(l, empty, "abc"s));
+}
+
 TEST_CASE("erase")
 {
    static std::vector<std::pair<std::vector<std::string_view>, std::string_view>> key_groups = {
@@ -223,6 +247,188 @@ TEST_CASE("recover")
    }
 }
 
+TEST_CASE("recover threads")
+{
+   temp_directory dir("triedent-test");
+   database::create(dir.path, database::config{1ull << 27, 1ull << 27, 1ull << 27, 1ull << 27});
+   constexpr int num_keys = 5000;
+   {
+      auto db      = std::make_shared<database>(dir.path, access_mode::read_write);
+      auto session = db->start_write_session();
+      // Two revisions which share most of their nodes
+      std::shared_ptr<triedent::root> r0;
+      for (int i = 0; i < num_keys; ++i)
+         session->upsert(r0, std::to_string(i), std::to_string(i));
+      auto r1 = r0;
+      for (int i = 0; i < num_keys; i += 7)
+         session->upsert(r1, std::to_string(i), "x"s);
+      std::shared_ptr<triedent::root> roots[] = {r0, r1};
+      std::shared_ptr<triedent::root> top_root;
+      session->upsert(top_root, ""s, roots);
+      session->set_top_root(top_root);
+   }
+   {
+      auto db      = std::make_shared<database>(dir.path, access_mode::read_write, true);
+      auto session = db->start_write_session();
+      session->start_collect_garbage();
+      std::uint64_t reported = 0;
+      session->recursive_retain(4, [&](std::uint64_t n) { reported = n; });
+      session->end_collect_garbage();
+      CHECK(reported > num_keys);
+   }
+   {
+      auto db      = std::make_shared<database>(dir.path, access_mode::read_write);
+      auto session = db->start_write_session();
+      auto root    = session->get_top_root();
+      std::vector<std::shared_ptr<triedent::root>> roots;
+      REQUIRE(session->get(root, ""s, nullptr, &roots));
+      REQUIRE(roots.size() == 2);
+      for (int i = 0; i < num_keys; ++i)
+      {
+         auto k = std::to_string(i);
+         CHECK(osv(session->get(roots[0], k)) == osv(k));
+         CHECK(osv(session->get(roots[1], k)) == osv(i % 7 == 0 ? "x"s : k));
+      }
+      // Releasing everything asserts if any reference counts were too low
+      roots.clear();
+      root.reset();
+      session->set_top_root(nullptr);
+   }
+}
+
+TEST_CASE("concurrent write sessions")
+{
+   auto db = createDb();
+
+   constexpr int                   num_keys    = 5000;
+   constexpr int                   num_threads = 4;
+   std::shared_ptr<triedent::root> base;
+   {
+      auto session = db->start_write_session();
+      for (int i = 0; i < num_keys; ++i)
+         session->upsert(base, std::to_string(i), std::to_string(i));
+   }
+   // The value that thread t leaves at key i, or empty if it removes the key
+   auto expected = [](int t, int i) -> std::string
+   {
+      if (i % num_threads == t)
+         return "u" + std::to_string(t);
+      if (i % 7 == t)
+         return "";
+      return std::to_string(i);
+   };
+
+   // Each thread starts from a copy of the same root. The second pass edits
+   // the nodes that the first pass cloned, which are now unique to the thread.
+   std::vector<std::shared_ptr<triedent::root>> results(num_threads);
+   std::vector<int>                             errors(num_threads);
+   {
+      std::vector<std::jthread> threads;
+      for (int t = 0; t < num_threads; ++t)
+      {
+         threads.emplace_back(
+             [&, t]
+             {
+                auto session = db->start_write_session();
+                auto root    = base;
+                for (std::string prefix : {"t", "u"})
+                {
+                   for (int i = 0; i < num_keys; ++i)
+                   {
+                      if (i % num_threads == t)
+                         session->upsert(root, std::to_string(i), prefix + std::to_string(t));
+                      else if (i % 7 == t)
+                         session->remove(root, std::to_string(i));
+                   }
+                }
+                for (int i = 0; i < num_keys; ++i)
+                   if (osv(session->get(root, std::to_string(i))).value_or("") != expected(t, i))
+                      ++errors[t];
+                for (int i = 0; i < num_keys; ++i)
+                   if (osv(session->get(base, std::to_string(i))) != osv(std::to_string(i)))
+                      ++errors[t];
+                results[t] = std::move(root);
+             });
+      }
+   }
+   for (int t = 0; t < num_threads; ++t)
+      CHECK(errors[t] == 0);
+
+   auto session = db->start_write_session();
+   for (int t = 0; t < num_threads; ++t)
+   {
+      for (int i = 0; i < num_keys; ++i)
+      {
+         auto k = std::to_string(i);
+         CHECK(osv(session->get(results[t], k)).value_or("") == expected(t, i));
+      }
+   }
+   // Releasing everything asserts if any reference counts were too low
+   results.clear();
+   base.reset();
+}
+
+TEST_CASE("file version")
+{
+   temp_directory dir("triedent-test");
+   database::create(dir.path, database::config{1ull << 27, 1ull << 27, 1ull << 27, 1ull << 27});
+   auto magic = [&]
+   {
+      std::uint32_t result;
+      std::ifstream in(dir.path / "db", std::ios::binary);
+      in.read(reinterpret_cast<char*>(&result), sizeof(result));
+      return result;
+   };
+   CHECK(magic() == file_magic);
+   {
+      std::fstream out(dir.path / "db", std::ios::binary | std::ios::in | std::ios::out);
+      out.write(reinterpret_cast<const char*>(&file_magic_v0), sizeof(file_magic_v0));
+   }
+   // Files from before packed inner nodes can be read, and are upgraded
+   // when they are opened for writing, so that older versions reject them.
+   std::make_shared<database>(dir.path, access_mode::read_only);
+   CHECK(magic() == file_magic_v0);
+   std::make_shared<database>(dir.path, access_mode::read_write);
+   CHECK(magic() == file_magic);
+}
+
+TEST_CASE("cold placement")
+{
+   auto db      = createDb(database::config{
+            .hot_bytes  = 1ull << 27,
+            .warm_bytes = 1ull << 27,
+            .cool_bytes = 1ull << 27,
+            .cold_bytes = 1ull << 27,
+   });
+   auto session = db->start_write_session();
+   constexpr int num_keys = 5000;
+
+   // A tree written to cold, then edited in hot and in cold
+   std::shared_ptr<triedent::root> root;
+   session->set_placement(placement::cold);
+   for (int i = 0; i < num_keys; ++i)
+      session->upsert(root, std::to_string(i), std::to_string(i));
+   auto snapshot = root;
+   session->set_placement(placement::hot);
+   for (int i = 0; i < num_keys; i += 3)
+      session->upsert(root, std::to_string(i), "x"s);
+   session->set_placement(placement::cold);
+   write_batch batch;
+   for (int i = 0; i < num_keys; i += 5)
+      batch.remove(std::to_string(i));
+   session->apply(root, batch);
+
+   for (int i = 0; i < num_keys; ++i)
+   {
+      auto k = std::to_string(i);
+      CHECK(osv(session->get(snapshot, k)) == osv(k));
+      if (i % 5 == 0)
+         CHECK(!session->get(root, k));
+      else
+         CHECK(osv(session->get(root, k)) == osv(i % 3 == 0 ? "x"s : k));
+   }
+}
+
 TEST_CASE("many refs")
 {
    // This should be larger than the maximum node refcount
@@ -254,3 +460,191 @@ TEST_CASE("many refs")
       REQUIRE(osv(session->get(r.front(), {"k", 1})) == std::optional{std::string_view{"v", 1}});
    }
 }
+
+TEST_CASE("apply batch")
+{
+   auto allow_unique = GENERATE(false, true);
+   auto seed         = GENERATE(range(0, 8));
+   auto db           = createDb(database::config{
+                 .hot_bytes  = 1ull << 27,
+                 .warm_bytes = 1ull << 27,
+                 .cool_bytes = 1ull << 27,
+                 .cold_bytes = 1ull << 27,
+   });
+   auto session      = db->start_write_session();
+   auto root         = session->get_top_root();
+
+   std::mt19937                                          rng(seed);
+   std::map<std::string, std::string>                    expected;
+   std::uniform_int_distribution<std::size_t>            key_len(0, 4);
+   std::uniform_int_distribution<int>                    key_char(0, 3);
+   auto                                                  random_key = [&]
+   {
+      std::string result(key_len(rng), '\0');
+      for (auto& ch : result)
+         ch = "\0\1\x80\xff"[key_char(rng)];
+      return result;
+   };
+
+   for (int i = 0; i < 64; ++i)
+   {
+      auto key      = random_key();
+      auto value    = std::to_string(i);
+      expected[key] = value;
+      session->upsert(root, key, value);
+   }
+
+   for (int round = 0; round < 8; ++round)
+   {
+      auto old_root     = root;
+      auto old_expected = expected;
+      if (allow_unique)
+         old_root.reset();
+
+      std::vector<std::string> storage;
+      std::vector<mutation>    batch;
+      storage.reserve(128);
+      for (int i = 0; i < 64; ++i)
+      {
+         auto& key = storage.emplace_back(random_key());
+         if (rng() % 3 == 0)
+         {
+            expected.erase(key);
+            batch.push_back({key, std::nullopt});
+         }
+         else
+         {
+            auto& value   = storage.emplace_back(std::to_string(round * 100 + i));
+            expected[key] = value;
+            batch.push_back({key, std::span<const char>{value}});
+         }
+      }
+      session->apply(root, batch);
+
+      auto check_content = [&](const auto& r, const auto& m)
+      {
+         std::vector<char> k, v;
+         auto              it = m.begin();
+         while (session->get_greater_equal(r, k, &k, &v, nullptr))
+         {
+            REQUIRE(it != m.end());
+            CHECK(std::string_view{k.data(), k.size()} == it->first);
+            CHECK(std::string_view{v.data(), v.size()} == it->second);
+            k.push_back(0);
+            ++it;
+         }
+         CHECK(it == m.end());
+      };
+      check_content(root, expected);
+      if (old_root)
+         check_content(old_root, old_expected);
+      session->validate(root);
+   }
+}
+
+TEST_CASE("cursor")
+{
+   auto seed    = GENERATE(range(0, 8));
+   auto db      = createDb(database::config{
+            .hot_bytes  = 1ull << 27,
+            .warm_bytes = 1ull << 27,
+            .cool_bytes = 1ull << 27,
+            .cold_bytes = 1ull << 27,
+   });
+   auto session = db->start_write_session();
+   auto root    = session->get_top_root();
+
+   std::mt19937                               rng(seed);
+   std::map<std::string, std::string>         expected;
+   std::uniform_int_distribution<std::size_t> key_len(0, 4);
+   std::uniform_int_distribution<int>         key_char(0, 3);
+   auto                                       random_key = [&]
+   {
+      std::string result(key_len(rng), '\0');
+      for (auto& ch : result)
+         ch = "\0\1\x80\xff"[key_char(rng)];
+      return result;
+   };
+
+   read_session::cursor empty(*session, nullptr);
+   CHECK(!empty.first());
+   CHECK(!empty.last());
+   CHECK(!empty.lower_bound(random_key()));
+
+   for (int i = 0; i < 48; ++i)
+   {
+      auto key      = random_key();
+      auto value    = std::to_string(i);
+      expected[key] = value;
+      session->upsert(root, key, value);
+   }
+
+   read_session::cursor c(*session, root);
+   std::vector<char>    k, v;
+   auto                 check_at = [&](auto it)
+   {
+      if (it == expected.end())
+      {
+         CHECK(!c.valid());
+         return;
+      }
+      REQUIRE(c.valid());
+      c.get_key(k);
+      c.get_value(&v, nullptr);
+      CHECK(std::string_view{k.data(), k.size()} == it->first);
+      CHECK(std::string_view{v.data(), v.size()} == it->second);
+   };
+
+   // Forward scan
+   c.first();
+   for (auto it = expected.begin(); it != expected.end(); ++it)
+   {
+      check_at(it);
+      c.next();
+   }
+   CHECK(!c.valid());
+
+   // Reverse scan
+   c.last();
+   for (auto it = expected.rbegin(); it != expected.rend(); ++it)
+   {
+      check_at(std::prev(it.base()));
+      c.prev();
+   }
+   CHECK(!c.valid());
+
+   // Seek, then step in both directions
+   for (int i = 0; i < 64; ++i)
+   {
+      auto key = random_key();
+      auto it  = expected.lower_bound(key);
+      CHECK(c.lower_bound(key) == (it != expected.end()));
+      check_at(it);
+      if (it != expected.begin())
+      {
+         auto p = std::prev(it);
+         c.prev();
+         check_at(p);
+         c.next();
+         check_at(it);
+      }
+      if (it != expected.end())
+      {
+         c.next();
+         check_at(std::next(it));
+      }
+   }
+
+   // The cursor keeps its snapshot while the tree changes
+   c.first();
+   auto snapshot = expected;
+   for (auto& [key, value] : expected)
+      session->upsert(root, key, "changed"s);
+   for (auto it = snapshot.begin(); it != snapshot.end(); ++it)
+   {
+      REQUIRE(c.valid());
+      c.get_value(&v, nullptr);
+      CHECK(std::string_view{v.data(), v.size()} == it->second);
+      c.next();
+   }
+}
@@ -1,5 +1,6 @@
 #include <psibase/ConfigFile.hpp>
 #include <psibase/EcdsaProver.hpp>
+#include <psibase/ProofPool.hpp>
 #include <psibase/TransactionContext.hpp>
 #include <psibase/bft.hpp>
 #include <psibase/cft.hpp>
@@ -31,6 +32,8 @@
 #include <mutex>
 #include <thread>
 
+#include <pthread.h>
+
 using namespace psibase;
 using namespace psibase::net;
 
@@ -209,6 +212,39 @@ void validate(boost::any& v, const std::vector<std::string>& values, byte_size*,
    v = result;
 };
 
+struct db_name
+{
+   DbId value;
+};
+
+constexpr std::pair<std::string_view, DbId> db_names[] = {
+    {"service", DbId::service},
+    {"writeOnly", DbId::writeOnly},
+    {"subjective", DbId::subjective},
+    {"nativeConstrained", DbId::nativeConstrained},
+    {"nativeUnconstrained", DbId::nativeUnconstrained},
+    {"blockLog", DbId::blockLog},
+    {"historyEvent", DbId::historyEvent},
+    {"uiEvent", DbId::uiEvent},
+    {"merkleEvent", DbId::merkleEvent},
+    {"blockProof", DbId::blockProof},
+};
+
+void validate(boost::any& v, const std::vector<std::string>& values, db_name*, int)
+{
+   boost::program_options::validators::check_first_occurrence(v);
+   auto s = boost::program_options::validators::get_single_string(values);
+   for (auto [name, db] : db_names)
+   {
+      if (s == name)
+      {
+         v = db_name{db};
+         return;
+      }
+   }
+   throw boost::program_options::invalid_option_value(s);
+}
+
 std::filesystem::path get_prefix()
 {
    auto prefix = std::filesystem::read_symlink("/proc/self/exe").parent_path();
@@ -540,13 +576,27 @@ void loop(Timer& timer, F&& f)
        });
 }
 
-bool pushTransaction(psibase::SharedState&                  sharedState,
-                     const std::shared_ptr<const Revision>& revisionAtBlockStart,
-                     BlockContext&                          bc,
-                     SystemContext&                         proofSystem,
-                     transaction_queue::entry&              entry,
-                     std::chrono::microseconds              proofWatchdogLimit)
+// The result of running a transaction's proofs and first auth check
+struct checked_transaction
+{
+   // Set if all checks passed
+   std::optional<SignedTransaction> trx;
+   // Holds the error if a check failed
+   TransactionTrace trace;
+   // Set if a check threw without recording an error in trace
+   std::exception_ptr exception;
+};
+
+// Checks a transaction before it is pushed. This only reads the state at the
+// beginning of the block, so it can run on any thread that has its own
+// SystemContext.
+checked_transaction checkTransaction(SystemContext&                         proofSystem,
+                                     const std::shared_ptr<const Revision>& revisionAtBlockStart,
+                                     TimePointSec                           time,
+                                     const transaction_queue::entry&        entry,
+                                     std::chrono::microseconds              proofWatchdogLimit)
 {
+   checked_transaction result;
    try
    {
       // TODO: verify no extra data
@@ -554,61 +604,90 @@ bool pushTransaction(psibase::SharedState&                  sharedState,
       auto             trx = psio::from_frac<SignedTransaction>(entry.packed_signed_trx);
       TransactionTrace trace;
 
+      try
+      {
+         check(trx.proofs.size() == trx.transaction->claims().size(),
+               "proofs and claims must have same size");
+         // All proofs execute as of the state at block begin. This will allow
+         // consistent parallel execution of all proofs within a block during
+         // replay. Proofs don't have direct database access, but they do rely
+         // on the set of services stored within the database. They may call
+         // other services; e.g. to call crypto functions.
+         //
+         // TODO: track CPU usage of proofs and pass it somehow to the main
+         //       execution for charging
+         // TODO: If by the time the transaction executes it's on a different
+         //       block than the proofs were verified on, then either the proofs
+         //       need to be rerun, or the hashes of the services which ran
+         //       during the proofs need to be compared against the current
+         //       service hashes. This will prevent a poison block.
+         // TODO: If the first proof and the first auth pass, but the transaction
+         //       fails (including other proof failures), then charge the first
+         //       authorizer
+         BlockContext proofBC{proofSystem, revisionAtBlockStart};
+         proofBC.start(time);
+         for (size_t i = 0; i < trx.proofs.size(); ++i)
+         {
+            proofBC.verifyProof(trx, trace, i, proofWatchdogLimit);
+            trace = {};
+         }
+
+         // The first auth check is a prefiltering measure and is mostly redundant
+         // with main execution. Unlike the proofs, the first auth check is allowed
+         // to run with any state on any fork. This is OK since the main execution
+         // checks all auths including the first; the worst that could happen is
+         // the transaction being rejected because it passes on one fork but not
+         // another, potentially charging the user for the failed transaction. The
+         // first auth check, when not part of the main execution, runs in read-only
+         // mode. TransactionSys lets the account's auth service know it's in a
+         // read-only mode so it doesn't fail the transaction trying to update its
+         // tables.
+         //
+         // Replay doesn't run the first auth check separately. This separate
+         // execution is a subjective measure; it's possible, but not advisable,
+         // for a modified node to skip it during production. This won't hurt
+         // consensus since replay never uses read-only mode for auth checks.
+         auto saveTrace = trace;
+         proofBC.checkFirstAuth(trx, trace, std::nullopt);
+         trace = std::move(saveTrace);
+
+         result.trx = std::move(trx);
+      }
+      catch (...)
+      {
+         // Don't give a false positive
+         if (!trace.error)
+            throw;
+         result.trace = std::move(trace);
+      }
+   }
+   catch (...)
+   {
+      // Reported by pushTransaction on the chain thread
+      result.exception = std::current_exception();
+   }
+   return result;
+}  // checkTransaction
+
+bool pushTransaction(BlockContext&             bc,
+                     transaction_queue::entry& entry,
+                     checked_transaction&&     checked)
+{
+   try
+   {
+      TransactionTrace trace;
+
       try
       {
          if (bc.needGenesisAction)
             trace.error = "Need genesis block; use 'psibase boot' to boot chain";
+         else if (checked.exception)
+            std::rethrow_exception(checked.exception);
+         else if (checked.trace.error)
+            trace = std::move(checked.trace);
          else
          {
-            check(trx.proofs.size() == trx.transaction->claims().size(),
-                  "proofs and claims must have same size");
-            // All proofs execute as of the state at block begin. This will allow
-            // consistent parallel execution of all proofs within a block during
-            // replay. Proofs don't have direct database access, but they do rely
-            // on the set of services stored within the database. They may call
-            // other services; e.g. to call crypto functions.
-            //
-            // TODO: move proof execution to background threads
-            // TODO: track CPU usage of proofs and pass it somehow to the main
-            //       execution for charging
-            // TODO: If by the time the transaction executes it's on a different
-            //       block than the proofs were verified on, then either the proofs
-            //       need to be rerun, or the hashes of the services which ran
-            //       during the proofs need to be compared against the current
-            //       service hashes. This will prevent a poison block.
-            // TODO: If the first proof and the first auth pass, but the transaction
-            //       fails (including other proof failures), then charge the first
-            //       authorizer
-            BlockContext proofBC{proofSystem, revisionAtBlockStart};
-            proofBC.start(bc.current.header.time);
-            for (size_t i = 0; i < trx.proofs.size(); ++i)
-            {
-               proofBC.verifyProof(trx, trace, i, proofWatchdogLimit);
-               trace = {};
-            }
-
-            // TODO: in another thread: check first auth and first proof. After
-            //       they pass, schedule the remaining proofs. After they pass,
-            //       schedule the transaction for execution in the main thread.
-            //
-            // The first auth check is a prefiltering measure and is mostly redundant
-            // with main execution. Unlike the proofs, the first auth check is allowed
-            // to run with any state on any fork. This is OK since the main execution
-            // checks all auths including the first; the worst that could happen is
-            // the transaction being rejected because it passes on one fork but not
-            // another, potentially charging the user for the failed transaction. The
-            // first auth check, when not part of the main execution, runs in read-only
-            // mode. TransactionSys lets the account's auth service know it's in a
-            // read-only mode so it doesn't fail the transaction trying to update its
-            // tables.
-            //
-            // Replay doesn't run the first auth check separately. This separate
-            // execution is a subjective measure; it's possible, but not advisable,
-            // for a modified node to skip it during production. This won't hurt
-            // consensus since replay never uses read-only mode for auth checks.
-            auto saveTrace = trace;
-            proofBC.checkFirstAuth(trx, trace, std::nullopt);
-            trace = std::move(saveTrace);
+            check(checked.trx.has_value(), "transaction was not checked");
 
             // TODO: RPC: don't forward failed transactions to P2P; this gives users
             //       feedback.
@@ -622,7 +701,7 @@ bool pushTransaction(psibase::SharedState&                  sharedState,
             //       shadow bill, and once shadow billing is in place, failed
             //       transaction billing seems unnecessary.
 
-            bc.pushTransaction(std::move(trx), trace, std::nullopt);
+            bc.pushTransaction(std::move(*checked.trx), trace, std::nullopt);
          }
       }
       RETHROW_BAD_ALLOC
@@ -777,6 +856,47 @@ struct MemStats
 };
 PSIO_REFLECT(MemStats, database, code, data, wasmMemory, wasmCode, unclassified)
 
+struct DatabaseStats
+{
+   // Roots waiting for the release thread to free them
+   std::size_t pendingReleases;
+};
+PSIO_REFLECT(DatabaseStats, pendingReleases)
+
+struct WasmStats
+{
+   std::uint64_t foregroundCompiles;
+   std::int64_t  foregroundCompileTime;
+   std::uint64_t backgroundCompiles;
+   std::int64_t  backgroundCompileTime;
+   std::size_t   pendingCompiles;
+   std::size_t   cacheBytes;
+};
+PSIO_REFLECT(WasmStats,
+             foregroundCompiles,
+             foregroundCompileTime,
+             backgroundCompiles,
+             backgroundCompileTime,
+             pendingCompiles,
+             cacheBytes)
+
+struct ContextPoolStats
+{
+   std::uint64_t acquisitions;
+   std::uint64_t created;
+   std::int64_t  waitTime;
+   std::size_t   idle;
+};
+PSIO_REFLECT(ContextPoolStats, acquisitions, created, waitTime, idle)
+
+struct ContextStats
+{
+   ContextPoolStats block;
+   ContextPoolStats proof;
+   ContextPoolStats rpc;
+};
+PSIO_REFLECT(ContextStats, block, proof, rpc)
+
 // TODO: this will need to be reworked when we have more complete transaction tracking
 struct TransactionStats
 {
@@ -794,8 +914,11 @@ struct Perf
    MemStats                memory;
    std::vector<ThreadInfo> tasks;
    TransactionStats        transactions;
+   DatabaseStats           database;
+   WasmStats               wasm;
+   ContextStats            contexts;
 };
-PSIO_REFLECT(Perf, timestamp, memory, tasks, transactions)
+PSIO_REFLECT(Perf, timestamp, memory, tasks, transactions, database, wasm, contexts)
 
 void write_om_descriptor(std::string_view name,
                          std::string_view type,
@@ -926,12 +1049,97 @@ void write_om_transaction_stats(const TransactionStats& stats, auto& stream)
    write_om_sample("psinode_transactions_unprocessed", std::to_string(stats.unprocessed), stream);
 }
 
+void write_om_database_stats(const DatabaseStats& stats, auto& stream)
+{
+   write_om_descriptor("psinode_database_pending_releases", "gauge", "",
+                       "Database roots waiting to be released", stream);
+   write_om_sample("psinode_database_pending_releases", std::to_string(stats.pendingReleases),
+                   stream);
+}
+
+void write_om_compile_sample(std::string_view name,
+                             std::string_view mode,
+                             std::string_view value,
+                             auto&            stream)
+{
+   stream.write(name.data(), name.size());
+   stream.write("{mode=", 6);
+   to_json(mode, stream);
+   stream.write("} ", 2);
+   stream.write(value.data(), value.size());
+   stream.write('\n');
+}
+
+void write_om_wasm_stats(const WasmStats& stats, auto& stream)
+{
+   write_om_descriptor("psinode_wasm_compiles", "counter", "", "Compiled Services", stream);
+   write_om_compile_sample("psinode_wasm_compiles_total", "foreground",
+                           std::to_string(stats.foregroundCompiles), stream);
+   write_om_compile_sample("psinode_wasm_compiles_total", "background",
+                           std::to_string(stats.backgroundCompiles), stream);
+   write_om_descriptor("psinode_wasm_compile_seconds", "counter", "seconds",
+                       "Time Spent Compiling Services", stream);
+   write_om_compile_sample("psinode_wasm_compile_seconds_total", "foreground",
+                           usec_as_sec(stats.foregroundCompileTime), stream);
+   write_om_compile_sample("psinode_wasm_compile_seconds_total", "background",
+                           usec_as_sec(stats.backgroundCompileTime), stream);
+   write_om_descriptor("psinode_wasm_pending_compiles", "gauge", "",
+                       "Services waiting to be compiled in the background", stream);
+   write_om_sample("psinode_wasm_pending_compiles", std::to_string(stats.pendingCompiles), stream);
+   write_om_descriptor("psinode_wasm_cache_bytes", "gauge", "bytes", "Compiled Service Cache Size",
+                       stream);
+   write_om_sample("psinode_wasm_cache_bytes", std::to_string(stats.cacheBytes), stream);
+}
+
+void write_om_pool_sample(std::string_view name,
+                          std::string_view pool,
+                          std::string_view value,
+                          auto&            stream)
+{
+   stream.write(name.data(), name.size());
+   stream.write("{pool=", 6);
+   to_json(pool, stream);
+   stream.write("} ", 2);
+   stream.write(value.data(), value.size());
+   stream.write('\n');
+}
+
+void write_om_context_stats(const ContextStats& stats, auto& stream)
+{
+   const std::pair<std::string_view, const ContextPoolStats*> pools[] = {
+       {"block", &stats.block},
+       {"proof", &stats.proof},
+       {"rpc", &stats.rpc},
+   };
+   write_om_descriptor("psinode_context_acquisitions", "counter", "",
+                       "Execution contexts taken from the pool", stream);
+   for (auto [name, pool] : pools)
+      write_om_pool_sample("psinode_context_acquisitions_total", name,
+                           std::to_string(pool->acquisitions), stream);
+   write_om_descriptor("psinode_context_created", "counter", "",
+                       "Execution contexts created because none were idle", stream);
+   for (auto [name, pool] : pools)
+      write_om_pool_sample("psinode_context_created_total", name, std::to_string(pool->created),
+                           stream);
+   write_om_descriptor("psinode_context_wait_seconds", "counter", "seconds",
+                       "Time Spent Acquiring Execution Contexts", stream);
+   for (auto [name, pool] : pools)
+      write_om_pool_sample("psinode_context_wait_seconds_total", name,
+                           usec_as_sec(pool->waitTime), stream);
+   write_om_descriptor("psinode_context_idle", "gauge", "", "Idle Execution Contexts", stream);
+   for (auto [name, pool] : pools)
+      write_om_pool_sample("psinode_context_idle", name, std::to_string(pool->idle), stream);
+}
+
 template <typename S>
 void to_openmetrics_text(const Perf& perf, S& stream)
 {
    write_om_mem(perf, stream);
    write_om_tasks(perf, stream);
    write_om_transaction_stats(perf.transactions, stream);
+   write_om_database_stats(perf.database, stream);
+   write_om_wasm_stats(perf.wasm, stream);
+   write_om_context_stats(perf.contexts, stream);
    stream.write("# EOF\n", 6);
 }
 
@@ -975,10 +1183,22 @@ ThreadInfo getThreadInfo(const std::filesystem::path& name, long clk_tck)
       {
          result.group = "http";
       }
-      else if (thread_name.starts_with("swap"))
+      else if (thread_name.starts_with("swap") || thread_name.starts_with("db-"))
       {
          result.group = "database";
       }
+      else if (thread_name.starts_with("proof"))
+      {
+         result.group = "proof";
+      }
+      else if (thread_name.starts_with("exec"))
+      {
+         result.group = "exec";
+      }
+      else if (thread_name.starts_with("wasm"))
+      {
+         result.group = "wasm";
+      }
    }
    {
       std::ifstream in(name / "io");
@@ -1203,6 +1423,25 @@ Perf get_perf(const SharedState& state, const TransactionStats& transactions)
                           .count();
    result.memory       = getMemStats(state);
    result.transactions = transactions;
+   result.database     = {.pendingReleases = state.dbPendingReleases()};
+   auto wasm           = state.wasmCacheStats();
+   result.wasm         = {.foregroundCompiles    = wasm.foregroundCompiles,
+                          .foregroundCompileTime = wasm.foregroundCompileTime,
+                          .backgroundCompiles    = wasm.backgroundCompiles,
+                          .backgroundCompileTime = wasm.backgroundCompileTime,
+                          .pendingCompiles       = wasm.pendingCompiles,
+                          .cacheBytes            = wasm.bytes};
+   auto poolStats = [&](SystemContextPool pool) -> ContextPoolStats
+   {
+      auto stats = state.poolStats(pool);
+      return {.acquisitions = stats.acquisitions,
+              .created      = stats.created,
+              .waitTime     = stats.waitTime,
+              .idle         = stats.idle};
+   };
+   result.contexts = {.block = poolStats(SystemContextPool::block),
+                      .proof = poolStats(SystemContextPool::proof),
+                      .rpc   = poolStats(SystemContextPool::rpc)};
    for (const auto& entry : std::filesystem::directory_iterator("/proc/self/task"))
    {
       result.tasks.push_back(getThreadInfo(entry, clk_tck));
@@ -1222,15 +1461,25 @@ inline constexpr std::size_t ceil_log2(std::size_t v)
 
 struct DbConfig
 {
-   DbConfig(byte_size cache)
+   DbConfig(byte_size                   cache,
+            const std::vector<db_name>& cold_writes,
+            const std::vector<db_name>& no_promote,
+            bool                        per_level_swap)
+       : per_level_swap(per_level_swap)
    {
       cool_bytes = warm_bytes = hot_bytes = cache.value / 2;
       cold_bytes                          = 64 * 1024 * 1024;
+      for (auto db : cold_writes)
+         policies[(int)db.value].coldWrites = true;
+      for (auto db : no_promote)
+         policies[(int)db.value].promote = false;
    }
    uint64_t hot_bytes;
    uint64_t warm_bytes;
    uint64_t cool_bytes;
    uint64_t cold_bytes;
+   DbPolicy policies[numDatabases];
+   bool     per_level_swap;
 };
 
 struct TLSConfig
@@ -1390,18 +1639,31 @@ void run(const std::string&              db_path,
          std::string                     tls_cert,
          std::string                     tls_key,
          uint32_t                        leeway_us,
+         uint32_t                        proof_threads,
+         uint32_t                        exec_threads,
+         bool                            compact_blocks,
+         bool                            range_sync,
+         std::size_t                     wasm_cache_size,
+         std::size_t                     wasm_prefault,
          RestartInfo&                    runResult)
 {
    ExecutionContext::registerHostFunctions();
 
-   // TODO: configurable WasmCache size
-   auto sharedState = std::make_shared<psibase::SharedState>(
-       SharedDatabase{db_path, db_conf.hot_bytes, db_conf.warm_bytes, db_conf.cool_bytes,
-                      db_conf.cold_bytes},
-       WasmCache{128});
+   SharedDatabase db{db_path, db_conf.hot_bytes, db_conf.warm_bytes, db_conf.cool_bytes,
+                     db_conf.cold_bytes, db_conf.per_level_swap};
+   for (uint32_t i = 0; i < numDatabases; ++i)
+      db.setPolicy((DbId)i, db_conf.policies[i]);
+   auto sharedState =
+       std::make_shared<psibase::SharedState>(std::move(db), WasmCache{wasm_cache_size});
+   sharedState->prewarm(SystemContextPool::block, 1 + exec_threads, wasm_prefault);
+   sharedState->prewarm(SystemContextPool::proof, 1 + proof_threads, wasm_prefault);
    auto system      = sharedState->getSystemContext();
-   auto proofSystem = sharedState->getSystemContext();
+   auto proofSystem = sharedState->getSystemContext(SystemContextPool::proof);
    auto queue       = std::make_shared<transaction_queue>();
+   auto proofPool   = std::make_unique<ProofPool>(*sharedState, proof_threads);
+   auto execPool    = exec_threads ? std::make_unique<ProofPool>(*sharedState, exec_threads, "exec",
+                                                                 SystemContextPool::block)
+                                   : nullptr;
    //
    TransactionStats transactionStats = {};
    std::mutex       transactionStatsMutex;
@@ -1459,8 +1721,10 @@ void run(const std::string&              db_path,
 #endif
 
    using node_type = node<peer_manager, direct_routing, consensus, ForkDb>;
-   node_type node(chainContext, system.get(), prover);
+   node_type node(chainContext, system.get(), prover, proofPool.get(), execPool.get());
    node.set_producer_id(producer);
+   node.set_compact_blocks(compact_blocks);
+   node.set_range_sync(range_sync);
    node.load_producers();
 
    // Used for outgoing connections
@@ -1530,6 +1794,7 @@ void run(const std::string&              db_path,
       http_config->enable_transactions = !host.empty();
       http_config->status =
           http::http_status{.slow = system->sharedDatabase.isSlow(), .startup = 1};
+      sharedState->prewarm(SystemContextPool::rpc, http_config->num_threads, wasm_prefault);
 
       for (const auto& entry : services)
       {
@@ -1592,6 +1857,9 @@ void run(const std::string&              db_path,
             runResult.shouldRestart = false;
          if (!soft)
             runResult.soft = false;
+         // A fork switch that is syncing many blocks would otherwise
+         // hold the chain thread until it finishes.
+         node.chain().interrupt();
          if (force)
          {
             chainContext.stop();
@@ -2001,14 +2269,29 @@ void run(const std::string&              db_path,
             // any transactions.
          }
          auto revisionAtBlockStart = node.chain().getHeadRevision();
-         for (auto& entry : entries)
+         // Proofs and first auth only read the state at the beginning of the
+         // block, so the whole batch is checked in parallel before any of it
+         // is pushed.
+         std::vector<checked_transaction> checked(entries.size());
+         if (!bc->needGenesisAction)
          {
-            bool res;
+            proofPool->run(*proofSystem, entries.size(),
+                           [&](SystemContext& context, std::size_t i)
+                           {
+                              if (!entries[i].is_boot)
+                                 checked[i] = checkTransaction(
+                                     context, revisionAtBlockStart, bc->current.header.time,
+                                     entries[i], std::chrono::microseconds(leeway_us));
+                           });
+         }
+         for (std::size_t i = 0; i < entries.size(); ++i)
+         {
+            auto& entry = entries[i];
+            bool  res;
             if (entry.is_boot)
                res = push_boot(*bc, entry);
             else
-               res = pushTransaction(*sharedState, revisionAtBlockStart, *bc, *proofSystem, entry,
-                                     std::chrono::microseconds(leeway_us));
+               res = pushTransaction(*bc, entry, std::move(checked[i]));
             {
                std::lock_guard lock{transactionStatsMutex};
                --transactionStats.unprocessed;
@@ -2042,7 +2325,40 @@ void run(const std::string&              db_path,
    };
    loop(timer, process_transactions);
 
+   // Compile the services that were in use before the last shutdown, so
+   // that their first requests do not wait for the compiler.
+   auto         wasmCacheFile = std::filesystem::path(db_path) / "wasm-cache";
+   std::jthread wasmWarm(
+       [wasmCache = system->wasmCache, db = system->sharedDatabase,
+        wasmCacheFile](std::stop_token stop) mutable
+       {
+          pthread_setname_np(pthread_self(), "wasm-warm");
+          try
+          {
+             auto n = wasmCache.warm(std::move(db), wasmCacheFile, stop);
+             PSIBASE_LOG(psibase::loggers::generic::get(), info)
+                 << "Compiled " << n << " services from " << wasmCacheFile.native();
+          }
+          catch (std::exception& e)
+          {
+             PSIBASE_LOG(psibase::loggers::generic::get(), warning)
+                 << "Failed to load " << wasmCacheFile.native() << ": " << e.what();
+          }
+       });
+
    chainContext.run();
+
+   wasmWarm.request_stop();
+   wasmWarm.join();
+   try
+   {
+      system->wasmCache.save(wasmCacheFile);
+   }
+   catch (std::exception& e)
+   {
+      PSIBASE_LOG(psibase::loggers::generic::get(), warning)
+          << "Failed to save " << wasmCacheFile.native() << ": " << e.what();
+   }
 }
 
 const char usage[] = "USAGE: psinode [OPTIONS] database";
@@ -2062,6 +2378,10 @@ int main(int argc, char* argv[])
    std::string                 host     = {};
    std::vector<listen_spec>    listen;
    uint32_t                    leeway_us = 200000;  // TODO: real value once resources are in place
+   uint32_t                    proof_threads;
+   uint32_t                    exec_threads;
+   bool                        compact_blocks = false;
+   bool                        range_sync     = false;
    std::vector<std::string>    peers;
    autoconnect_t               autoconnect;
    bool                        enable_incoming_p2p = false;
@@ -2072,7 +2392,12 @@ int main(int argc, char* argv[])
    std::string                 tls_cert;
    std::string                 tls_key;
    byte_size                   db_cache_size;
+   std::vector<db_name>        db_cold_writes;
+   std::vector<db_name>        db_no_promote;
+   bool                        db_per_level_swap = false;
    byte_size                   db_size;
+   byte_size                   wasm_cache_size;
+   byte_size                   wasm_prefault;
    bool                        version;
 
    namespace po = boost::program_options;
@@ -2103,6 +2428,17 @@ int main(int argc, char* argv[])
        po::value(&db_cache_size)->default_value({std::size_t(1) << 33}, "8 GiB"),
        "The amount of RAM reserved for the database cache. Must be at least 64 MiB. Warning: this "
        "will not modify an existing database. This option is subject to change.");
+   opt("database-cold-writes", po::value(&db_cold_writes)->default_value({}, "")->value_name("db"),
+       "Databases whose new data is written directly to cold storage instead of the database "
+       "cache. Candidates are databases that are appended to and rarely read back, such as "
+       "historyEvent. This option is subject to change.");
+   opt("database-no-promote", po::value(&db_no_promote)->default_value({}, "")->value_name("db"),
+       "Databases whose data is not moved into the database cache when it is read. This option "
+       "is subject to change.");
+   opt("database-per-level-swap",
+       po::bool_switch(&db_per_level_swap)->default_value(false, "off"),
+       "Move data out of each level of the database cache on its own thread, instead of one "
+       "thread for all levels. This option is subject to change.");
 #ifdef PSIBASE_ENABLE_SSL
    opt("tls-trustfile", po::value(&root_ca)->default_value({}, "")->value_name("path"),
        "A list of trusted Certification Authorities in PEM format");
@@ -2113,6 +2449,26 @@ int main(int argc, char* argv[])
 #endif
    opt("leeway", po::value<uint32_t>(&leeway_us)->default_value(200000),
        "Transaction leeway, in µs.");
+   opt("proof-threads", po::value<uint32_t>(&proof_threads)->default_value(3),
+       "The number of threads, in addition to the chain thread, which verify transaction proofs");
+   opt("exec-threads", po::value<uint32_t>(&exec_threads)->default_value(0),
+       "The number of threads, in addition to the chain thread, which execute the transactions "
+       "in received blocks in parallel. 0 executes them on the chain thread only.");
+   opt("compact-blocks", po::bool_switch(&compact_blocks)->default_value(false, "off"),
+       "Send new blocks to peers that are caught up as transaction ids. A peer that already has "
+       "the block from another peer drops it. Otherwise it fetches the transactions, which costs "
+       "a round trip");
+   opt("range-sync", po::bool_switch(&range_sync)->default_value(false, "off"),
+       "While catching up, download irreversible blocks in batches from all peers that have them "
+       "instead of having each peer push them. Batches are only requested from peers that also "
+       "enable this option");
+   opt("wasm-cache-size",
+       po::value(&wasm_cache_size)->default_value({std::size_t(1) << 29}, "512 MiB"),
+       "The amount of RAM used to keep compiled services. Services that were compiled when the "
+       "node stops are compiled again in the background when it starts.");
+   opt("wasm-prefault", po::value(&wasm_prefault)->default_value({0}, "0"),
+       "The amount of each WASM linear memory to fault in at startup. This avoids page faults "
+       "in the first transactions and queries at the cost of RAM for every memory.");
    opt("version,V", po::bool_switch(&version), "Print version information");
    desc.add(common_opts);
    opt = desc.add_options();
@@ -2196,9 +2552,11 @@ int main(int argc, char* argv[])
          restart.shutdownRequested = false;
          restart.shouldRestart     = true;
          restart.soft              = true;
-         run(db_path, DbConfig{db_cache_size}, AccountNumber{producer}, keys, peers, autoconnect,
-             enable_incoming_p2p, host, listen, services, admin, admin_authz, root_ca, tls_cert,
-             tls_key, leeway_us, restart);
+         run(db_path, DbConfig{db_cache_size, db_cold_writes, db_no_promote, db_per_level_swap},
+             AccountNumber{producer}, keys, peers, autoconnect, enable_incoming_p2p, host, listen,
+             services, admin, admin_authz, root_ca, tls_cert, tls_key, leeway_us, proof_threads,
+             exec_threads, compact_blocks, range_sync, wasm_cache_size.value, wasm_prefault.value,
+             restart);
          if (!restart.shouldRestart || !restart.shutdownRequested)
          {
             PSIBASE_LOG(psibase::loggers::generic::get(), info) << "Shutdown";
@@ -187,8 +187,8 @@ struct test_chain
       dir    = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
       db     = {dir, hot_bytes, warm_bytes, cool_bytes, cold_bytes};
       writer = db.createWriter();
-      sys    = std::make_unique<psibase::SystemContext>(
-          psibase::SystemContext{db, {128}, {}, state.watchdogManager});
+      sys    = std::unique_ptr<psibase::SystemContext>(new psibase::SystemContext{
+          db, psibase::WasmCache{1ull << 27}, {}, state.watchdogManager});
    }
 
    test_chain(const test_chain&)            = delete;
@@ -869,6 +869,29 @@ struct callbacks
       return result;
    }
 
+   uint32_t kvIterOpen(uint32_t db, eosio::vm::span<const char> key, uint32_t matchKeySize)
+   {
+      return native().kvIterOpen(db, key, matchKeySize);
+   }
+
+   uint32_t kvIterNext(uint32_t iterator)
+   {
+      auto& n      = native();
+      auto  result = n.kvIterNext(iterator);
+      setResult(n);
+      return result;
+   }
+
+   uint32_t kvIterPrev(uint32_t iterator)
+   {
+      auto& n      = native();
+      auto  result = n.kvIterPrev(iterator);
+      setResult(n);
+      return result;
+   }
+
+   void kvIterClose(uint32_t iterator) { native().kvIterClose(iterator); }
+
    uint32_t kvGetTransactionUsage()
    {
       auto& n      = native();
@@ -917,6 +940,10 @@ void register_callbacks()
    rhf_t::add<&callbacks::kvGreaterEqual>("env", "kvGreaterEqual");
    rhf_t::add<&callbacks::kvLessThan>("env", "kvLessThan");
    rhf_t::add<&callbacks::kvMax>("env", "kvMax");
+   rhf_t::add<&callbacks::kvIterOpen>("env", "kvIterOpen");
+   rhf_t::add<&callbacks::kvIterNext>("env", "kvIterNext");
+   rhf_t::add<&callbacks::kvIterPrev>("env", "kvIterPrev");
+   rhf_t::add<&callbacks::kvIterClose>("env", "kvIterClose");
    rhf_t::add<&callbacks::kvGetTransactionUsage>("env", "kvGetTransactionUsage");
 }
 
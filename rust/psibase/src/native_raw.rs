@@ -108,4 +108,29 @@ extern "C" {
     /// Otherwise returns `u32::MAX` and clears result. Use [getResult] to get result
     /// and [getKey] to get found key.
     pub fn kvMax(db: crate::DbId, key: *const u8, key_len: u32) -> u32;
+
+    /// Open an iterator positioned before the first key which is greater
+    /// than or equal to the provided key
+    ///
+    /// The iterator only visits keys whose first `match_key_size` bytes match
+    /// the provided key. It sees the database as it was when it was opened.
+    /// Returns a handle for [kvIterNext], [kvIterPrev], and [kvIterClose].
+    pub fn kvIterOpen(db: crate::DbId, key: *const u8, key_len: u32, match_key_size: u32) -> u32;
+
+    /// Advance an iterator past the next key-value pair
+    ///
+    /// If there is one, then sets result to value and returns size. Also sets
+    /// key. Otherwise returns `u32::MAX` and clears result. Use [getResult] to get
+    /// result and [getKey] to get found key.
+    pub fn kvIterNext(iterator: u32) -> u32;
+
+    /// Move an iterator back before the previous key-value pair
+    ///
+    /// If there is one, then sets result to value and returns size. Also sets
+    /// key. Otherwise returns `u32::MAX` and clears result. Use [getResult] to get
+    /// result and [getKey] to get found key.
+    pub fn kvIterPrev(iterator: u32) -> u32;
+
+    /// Close an iterator. The handle may be reused by a later [kvIterOpen].
+    pub fn kvIterClose(iterator: u32);
 }
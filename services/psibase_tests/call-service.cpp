@@ -0,0 +1,32 @@
+#include "call-service.hpp"
+
+#include <psibase/block.hpp>
+#include <psibase/nativeFunctions.hpp>
+
+using namespace psibase;
+using namespace call_bench;
+
+extern "C" void __wasm_call_ctors();
+extern "C" void start(AccountNumber this_service)
+{
+   __wasm_call_ctors();
+}
+
+extern "C" void called(AccountNumber this_service, AccountNumber sender)
+{
+   auto act  = getCurrentAction();
+   auto args = psio::from_frac<CallArgs>(act.rawData);
+   if (args.depth)
+   {
+      auto r = psio::from_frac<uint32_t>(call({
+          .sender  = this_service,
+          .service = this_service,
+          .rawData = psio::convert_to_frac(CallArgs{
+              .depth = args.depth - 1,
+              .data  = std::move(args.data),
+          }),
+      }));
+      check(r == args.depth - 1, "wrong return value");
+   }
+   setRetval(args.depth);
+}
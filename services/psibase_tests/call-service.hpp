@@ -0,0 +1,15 @@
+#pragma once
+
+#include <psio/fracpack.hpp>
+#include <vector>
+
+namespace call_bench
+{
+   // call-service calls itself depth times, forwarding data each time
+   struct CallArgs
+   {
+      uint32_t          depth;
+      std::vector<char> data;
+   };
+   PSIO_REFLECT(CallArgs, depth, data)
+}  // namespace call_bench
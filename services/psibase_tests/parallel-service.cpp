@@ -0,0 +1,48 @@
+#include "parallel-service.hpp"
+
+#include <psibase/dispatch.hpp>
+
+using namespace psibase;
+
+namespace
+{
+   constexpr std::uint8_t balanceTable = 0;
+   constexpr std::uint8_t totalTable   = 1;
+
+   auto balanceKey(AccountNumber account)
+   {
+      return std::tuple(ParallelService::service, balanceTable, account);
+   }
+
+   std::uint64_t getBalance(AccountNumber account)
+   {
+      return kvGet<std::uint64_t>(balanceKey(account)).value_or(0);
+   }
+}  // namespace
+
+void ParallelService::credit(AccountNumber account, uint64_t amount)
+{
+   kvPut(balanceKey(account), getBalance(account) + amount);
+}
+
+void ParallelService::transfer(AccountNumber from, AccountNumber to, uint64_t amount)
+{
+   auto balance = getBalance(from);
+   check(balance >= amount, "insufficient balance");
+   kvPut(balanceKey(from), balance - amount);
+   kvPut(balanceKey(to), getBalance(to) + amount);
+   emit().history().transferred(from, to, amount);
+}
+
+void ParallelService::sum(uint32_t id)
+{
+   auto          prefix = psio::convert_to_key(std::tuple(service, balanceTable));
+   auto          it     = kvIterOpenRaw(DbId::service, prefix, prefix.size());
+   std::uint64_t total  = 0;
+   while (auto amount = kvIterNext<std::uint64_t>(it))
+      total += *amount;
+   kvIterClose(it);
+   kvPut(std::tuple(service, totalTable, id), total);
+}
+
+PSIBASE_DISPATCH(ParallelService)
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <psibase/Service.hpp>
+
+// Conflicting and independent transactions for testing parallel execution
+struct ParallelService : psibase::Service<ParallelService>
+{
+   static constexpr auto service = psibase::AccountNumber{"parallel-service"};
+   struct Events
+   {
+      struct History
+      {
+         void transferred(psibase::AccountNumber from, psibase::AccountNumber to, uint64_t amount);
+      };
+      struct Ui
+      {
+      };
+      struct Merkle
+      {
+      };
+   };
+   void credit(psibase::AccountNumber account, uint64_t amount);
+   // Aborts if from does not have enough
+   void transfer(psibase::AccountNumber from, psibase::AccountNumber to, uint64_t amount);
+   // Stores the sum of all balances, which it reads with an iterator
+   void sum(uint32_t id);
+};
+
+PSIO_REFLECT(ParallelService,
+             method(credit, account, amount),
+             method(transfer, from, to, amount),
+             method(sum, id))
+
+PSIBASE_REFLECT_EVENTS(ParallelService)
+
+PSIBASE_REFLECT_HISTORY_EVENTS(ParallelService, method(transferred, from, to, amount))
+
+PSIBASE_REFLECT_UI_EVENTS(ParallelService)
+PSIBASE_REFLECT_MERKLE_EVENTS(ParallelService)
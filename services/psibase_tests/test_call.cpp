@@ -0,0 +1,73 @@
+#include "call-service.hpp"
+
+#include <psibase/DefaultTestChain.hpp>
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace psibase;
+using namespace call_bench;
+
+namespace
+{
+   Action callAction(AccountNumber service, uint32_t depth, std::vector<char> data)
+   {
+      return {
+          .sender  = service,
+          .service = service,
+          .rawData = psio::convert_to_frac(CallArgs{.depth = depth, .data = std::move(data)}),
+      };
+   }
+}  // namespace
+
+TEST_CASE("nested calls")
+{
+   DefaultTestChain t;
+   auto             service = t.addService("call-service"_a, "call-service.wasm");
+
+   auto trace = t.pushTransaction(t.makeTransaction({callAction(service, 16, {'a', 'b', 'c'})}));
+   REQUIRE(show(false, trace) == "");
+   auto* atrace = &trace.actionTraces.back();
+   for (uint32_t depth = 16; depth > 0; --depth)
+   {
+      CHECK(psio::from_frac<CallArgs>(atrace->action.rawData).depth == depth);
+      CHECK(psio::from_frac<uint32_t>(atrace->rawRetval) == depth);
+      REQUIRE(atrace->innerTraces.size() == 1);
+      atrace = &std::get<ActionTrace>(atrace->innerTraces.back().inner);
+   }
+   CHECK(psio::from_frac<CallArgs>(atrace->action.rawData).data == std::vector{'a', 'b', 'c'});
+}
+
+// Reports transaction latency against the depth of nested calls and the
+// size of the action data that is passed down. Run with [benchmark].
+TEST_CASE("nested call latency", "[.][benchmark]")
+{
+   DefaultTestChain t;
+   auto             service = t.addService("call-service"_a, "call-service.wasm");
+
+   constexpr int iterations = 50;
+   printf("%8s %10s %12s\n", "depth", "data", "us/trx");
+   for (std::size_t size : {0, 1024, 16384})
+   {
+      for (uint32_t depth : {0, 1, 4, 16, 64})
+      {
+         std::chrono::steady_clock::duration elapsed{};
+         for (int i = 0; i < iterations; ++i)
+         {
+            // Vary the data so that no two transactions are the same
+            std::vector<char> data(size + sizeof(i));
+            std::memcpy(data.data(), &i, sizeof(i));
+            auto trx   = t.makeTransaction({callAction(service, depth, std::move(data))});
+            auto start = std::chrono::steady_clock::now();
+            auto trace = t.pushTransaction(trx);
+            elapsed += std::chrono::steady_clock::now() - start;
+            REQUIRE(show(false, trace) == "");
+         }
+         auto us = std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+         printf("%8u %10zu %12.1f\n", depth, size, us);
+      }
+      t.startBlock();
+   }
+}
@@ -155,6 +155,76 @@ void test(AccountNumber thisService)
          printf("\n");
    }  // kvMax
 
+   // An iterator which was just opened should find the same rows as
+   // kvGreaterEqual (next) and kvLessThan (prev)
+   auto iterNext = [](DbId db, psio::input_stream key, size_t matchKeySize)
+   {
+      auto it     = kvIterOpenRaw(db, key, matchKeySize);
+      auto result = kvIterNextRaw(it);
+      kvIterClose(it);
+      return result;
+   };
+   auto iterPrev = [](DbId db, psio::input_stream key, size_t matchKeySize)
+   {
+      auto it     = kvIterOpenRaw(db, key, matchKeySize);
+      auto result = kvIterPrevRaw(it);
+      kvIterClose(it);
+      return result;
+   };
+
+   if (enable_print)
+      printf("kvIterNext\n");
+   for (const auto& item : items)
+   {
+      auto key = item.getKey(thisService);
+      if (enable_print)
+      {
+         printf("    0x%02x ", item.value);
+         fflush(stdout);
+      }
+      run(4, item.ge4, key, iterNext);
+      run(5, item.ge5, key, iterNext);
+      run(6, item.ge6, key, iterNext);
+      if (enable_print)
+         printf("\n");
+   }  // kvIterNext
+
+   if (enable_print)
+      printf("kvIterPrev\n");
+   for (const auto& item : items)
+   {
+      auto key = item.getKey(thisService);
+      if (enable_print)
+      {
+         printf("    0x%02x ", item.value);
+         fflush(stdout);
+      }
+      run(4, item.lt4, key, iterPrev);
+      run(5, item.lt5, key, iterPrev);
+      run(6, item.lt6, key, iterPrev);
+      if (enable_print)
+         printf("\n");
+   }  // kvIterPrev
+
+   // Walk the whole service prefix in both directions
+   {
+      auto                 prefix = psio::convert_to_key(thisService);
+      auto                 it     = kvIterOpenRaw(DbId::service, prefix, prefix.size());
+      std::vector<uint8_t> forward, backward;
+      while (auto v = kvIterNextRaw(it))
+         forward.push_back(psio::convert_from_bin<uint8_t>(*v));
+      while (auto v = kvIterPrevRaw(it))
+         backward.push_back(psio::convert_from_bin<uint8_t>(*v));
+      kvIterClose(it);
+      std::vector<uint8_t> expected;
+      for (const auto& item : items)
+         if (item.add && item.keep)
+            expected.push_back(item.value);
+      check(forward == expected, "kvIterNext did not visit every row in order");
+      std::reverse(backward.begin(), backward.end());
+      check(backward == expected, "kvIterPrev did not visit every row in order");
+   }
+
 }  // test()
 
 extern "C" void called(AccountNumber thisService, AccountNumber sender)
@@ -0,0 +1,204 @@
+#include <psibase/ForkDb.hpp>
+#include <psibase/ProofPool.hpp>
+
+#include <parallel-service.hpp>
+
+#include <chrono>
+#include <cstdio>
+
+#include "test_util.hpp"
+
+using namespace psibase;
+
+namespace
+{
+   using Rows = std::vector<std::pair<std::vector<char>, std::vector<char>>>;
+
+   auto parallelService()
+   {
+      return transactor<ParallelService>(ParallelService::service, ParallelService::service);
+   }
+
+   struct TestChain
+   {
+      TestChain() : system(db.getSystemContext()), chain(system.get())
+      {
+         produce(
+             [](BlockContext* ctx)
+             {
+                boot(ctx, cft("prod"), false,
+                     {{
+                         .service = ParallelService::service,
+                         .code    = readWholeFile("parallel-service.wasm"),
+                     }});
+             });
+      }
+      ~TestChain() { db.sharedState->addSystemContext(std::move(system)); }
+
+      // Produces a block with the transactions that f pushes
+      BlockHeaderState* produce(auto&& f)
+      {
+         chain.start_block(TimePointSec{chain.get_head()->time.seconds + 1},
+                           AccountNumber{"prod"}, 0, chain.commit_index());
+         f(chain.getBlockContext());
+         auto* result = chain.finish_block([](const BlockHeaderState*)
+                                           { return std::optional<std::vector<char>>{}; });
+         REQUIRE(result);
+         return result;
+      }
+
+      BlockHeaderState* produce(const std::vector<Action>& actions)
+      {
+         return produce(
+             [&](BlockContext* ctx)
+             {
+                for (const auto& action : actions)
+                   pushTransaction(ctx, Transaction{.tapos = getTapos(ctx), .actions = {action}});
+             });
+      }
+
+      // Executes the block on top of its parent, without a pool if pool is null
+      ConstRevisionPtr execute(Block block, const ConstRevisionPtr& base, ProofPool* pool)
+      {
+         BlockContext ctx{*system, base, system->sharedDatabase.createWriter(), false};
+         ctx.start(std::move(block));
+         ctx.callStartBlock();
+         if (pool)
+            ctx.execAllInBlock(*pool);
+         else
+            ctx.execAllInBlock();
+         return ctx.db.getModifiedRevision();
+      }
+
+      Rows dump(const ConstRevisionPtr& revision, DbId db)
+      {
+         Database          database{system->sharedDatabase, revision};
+         auto              session = database.startRead();
+         Rows              result;
+         std::vector<char> key;
+         while (auto row = database.kvGreaterEqualRaw(db, key, 0))
+         {
+            key = row->key.vector();
+            result.emplace_back(key, row->value.vector());
+            key.push_back(0);
+         }
+         return result;
+      }
+
+      std::optional<std::uint64_t> get(const ConstRevisionPtr& revision, std::uint8_t table, auto k)
+      {
+         Database database{system->sharedDatabase, revision};
+         auto     session = database.startRead();
+         return database.kvGet<std::uint64_t>(DbId::service,
+                                              std::tuple(ParallelService::service, table, k));
+      }
+
+      TempDatabase                   db;
+      std::unique_ptr<SystemContext> system;
+      ForkDb                         chain;
+   };
+
+   Block getBlock(TestChain& t, const BlockHeaderState* state)
+   {
+      return t.chain.get(state->blockId())->block().unpack();
+   }
+}  // namespace
+
+TEST_CASE("parallel execution")
+{
+   TestChain t;
+   auto      credits = t.produce({
+       parallelService().credit(AccountNumber{"alice"}, 100),
+       parallelService().credit(AccountNumber{"bob"}, 100),
+       parallelService().credit(AccountNumber{"erin"}, 50),
+   });
+   auto      state   = t.produce({
+       // Reads every balance before anything is written
+       parallelService().sum(0),
+       parallelService().credit(AccountNumber{"gina"}, 7),
+       parallelService().transfer(AccountNumber{"alice"}, AccountNumber{"bob"}, 10),
+       // Fails against the start of the block, but not after the previous transfer
+       parallelService().transfer(AccountNumber{"bob"}, AccountNumber{"carol"}, 105),
+       parallelService().credit(AccountNumber{"henry"}, 3),
+       // Independent of the other transfers except for the event number
+       parallelService().transfer(AccountNumber{"erin"}, AccountNumber{"frank"}, 1),
+       parallelService().credit(AccountNumber{"gina"}, 2),
+       // Reads the balances written by the earlier transactions
+       parallelService().sum(1),
+   });
+   auto      block   = getBlock(t, state);
+
+   ProofPool pool{*t.db.sharedState, 4, "exec", SystemContextPool::block};
+   auto      serial   = t.execute(block, credits->revision, nullptr);
+   auto      parallel = t.execute(block, credits->revision, &pool);
+
+   for (std::uint32_t db = 0; db < numDatabases; ++db)
+   {
+      if (DbId{db} == DbId::subjective)
+         continue;
+      INFO("database: " << db);
+      CHECK(t.dump(serial, DbId{db}) == t.dump(parallel, DbId{db}));
+   }
+   CHECK(t.get(parallel, 0, AccountNumber{"bob"}) == 5);
+   CHECK(t.get(parallel, 0, AccountNumber{"carol"}) == 105);
+   CHECK(t.get(parallel, 0, AccountNumber{"gina"}) == 9);
+   CHECK(t.get(parallel, 1, std::uint32_t{0}) == 250);
+   CHECK(t.get(parallel, 1, std::uint32_t{1}) == 262);
+   CHECK(t.dump(parallel, DbId::historyEvent).size() ==
+         t.dump(credits->revision, DbId::historyEvent).size() + 3);
+
+   // A transaction that fails in order fails the block
+   auto failed = block;
+   failed.transactions.push_back(signTransaction(
+       credits->info,
+       Transaction{.actions = {parallelService().transfer(AccountNumber{"carol"},
+                                                          AccountNumber{"alice"}, 1000)}}));
+   failed.transactions.back().subjectiveData = failed.transactions.front().subjectiveData;
+   CHECK_THROWS(t.execute(failed, credits->revision, nullptr));
+   CHECK_THROWS(t.execute(failed, credits->revision, &pool));
+}
+
+// Times the execution of blocks of independent credits, which run in
+// parallel, and of transfers between separate accounts, which all emit
+// events and are therefore executed again in order.
+TEST_CASE("parallel execution benchmark", "[.][benchmark]")
+{
+   constexpr std::uint32_t numTransactions = 1000;
+
+   TestChain t;
+   auto      run = [&](const char* name, auto&& makeAction)
+   {
+      auto head    = t.chain.get_head_state();
+      auto state   = t.produce(
+          [&](BlockContext* ctx)
+          {
+             for (std::uint32_t i = 0; i < numTransactions; ++i)
+                pushTransaction(ctx,
+                                Transaction{.tapos = getTapos(ctx), .actions = {makeAction(i)}});
+          });
+      auto block   = getBlock(t, state);
+      auto elapsed = [&](ProofPool* pool)
+      {
+         auto start = std::chrono::steady_clock::now();
+         t.execute(block, head->revision, pool);
+         return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      };
+      auto serial = elapsed(nullptr);
+      std::printf("%-10s serial   %8.0f trx/s\n", name, numTransactions / serial);
+      for (std::size_t threads : {1, 2, 4, 8})
+      {
+         ProofPool pool{*t.db.sharedState, threads, "exec", SystemContextPool::block};
+         auto      seconds = elapsed(&pool);
+         std::printf("%-10s %zu thread%s %8.0f trx/s %5.2fx\n", name, threads,
+                     threads == 1 ? " " : "s", numTransactions / seconds, serial / seconds);
+      }
+   };
+   run("credit", [](std::uint32_t i)
+       { return parallelService().credit(AccountNumber{"a" + std::to_string(i)}, 1); });
+   run("transfer",
+       [](std::uint32_t i)
+       {
+          return parallelService().transfer(AccountNumber{"a" + std::to_string(i)},
+                                            AccountNumber{"b" + std::to_string(i)}, 1);
+       });
+}